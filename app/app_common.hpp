@@ -0,0 +1,111 @@
+#ifndef APP_COMMON_HPP
+#define APP_COMMON_HPP
+
+// Setup shared by the windowed and headless entry points
+
+#include <iostream>
+#include <string>
+
+#include "gridworld.hpp"
+#include "abstract_actor.hpp"
+#include "smart_actor.hpp"
+#include "crafted_actor.hpp"
+#include "rollout_actor.hpp"
+#include "world_snapshot.hpp"
+#include "tile.hpp"
+#include "param_reader.hpp"
+#include "data_writer.hpp"
+#include "thread_pool.hpp"
+
+// takes list of config files as arguments
+inline void loadConfigFiles(int argc, char** argv) {
+    ClassConfigFiles configFiles;
+    for (int i = 1; i < argc; i++) {
+        // get the config file name
+        std::string file_path = argv[i];
+        int extension_index = file_path.find_last_of('.');
+        if (extension_index == std::string::npos) {
+            std::cerr << "Invalid config file " << file_path << std::endl;
+            continue;
+        }
+        int path_end = file_path.find_last_of('/');
+        if (extension_index < path_end) {
+            std::cerr << "Invalid config file " << file_path << std::endl;
+            continue;
+        }
+        std::string class_name = file_path.substr(path_end+1, extension_index - path_end - 1);
+        std::cout << "Found class " << class_name << " with config file " << file_path << std::endl;
+        configFiles.push_back(ClassConfigFile(class_name, argv[i]));
+    }
+    data_management::ParamReader& reader = data_management::ParamReader::getInstance();
+    reader.addConfigFiles(configFiles);
+
+    // hack solution to prevent memory corruption in reader.config in GridWord,GridWorldView constructors
+    data_management::ParamReader::getInstance().getParam<float>("Data", "max_time", 0);
+    data_management::ParamReader::getInstance().getParam<size_t>("GridWorld", "width", 10);
+}
+
+inline void openDataFile() {
+    data_management::ParamReader& reader = data_management::ParamReader::getInstance();
+    data_management::DataWriter& writer = data_management::DataWriter::getInstance();
+    std::string data_file = reader.getParam<std::string>("Data", "filename", "trial.data");
+    std::string write_dir = reader.getParam<std::string>("Data", "directory", "data/raw/");
+    std::string write_path = write_dir + data_file;
+    writer.openFile(write_path);
+    writer.writeData("Time Elapsed", data_management::DataType::DOUBLE, 0.0);
+}
+
+// pool for the decide phase sized by GridWorld.numThreads, nullptr for serial
+inline std::shared_ptr<ThreadPool> makeThreadPool() {
+    size_t numThreads = data_management::ParamReader::getInstance().getParam<size_t>("GridWorld", "numThreads", 1);
+    if (numThreads <= 1) {
+        return nullptr;
+    }
+    return std::make_shared<ThreadPool>(numThreads);
+}
+
+// action policy of type Data.actor_type for a character of the world
+inline ActorPtr makeActor(GridWorld& gridWorld, size_t characterID) {
+    std::string actorType = data_management::ParamReader::getInstance().getParam<std::string>("Data", "actor_type", "random");
+    if (actorType == "random") {
+        // random action policy
+        return std::make_unique<RandomActor>(gridWorld.getRandomSeed());
+    } else if (actorType == "crafted") {
+        // crafted action policy
+        return std::make_unique<CraftedActor>(gridWorld, characterID);
+    } else if (actorType == "rollout") {
+        // search over simulated futures
+        return std::make_unique<RolloutActor>(gridWorld, characterID);
+    }
+    // smart action policy
+    return std::make_unique<rl::SmartActor>(gridWorld);
+}
+
+// generates the map and places the characters with their action policies
+inline void setupWorld(GridWorld& gridWorld) {
+
+    static ResourceManager grain{Resources{200}, Resources{10}, Resources{200}};
+
+    std::vector<ResourceManagerRef> tile_prototypes;
+    std::vector<double> weights;
+
+    tile_prototypes.push_back(grain);
+    weights.push_back(1.0);
+    gridWorld.addTilePrototypes(tile_prototypes, weights);
+    gridWorld.GenerateTileMap();
+
+    // Add a character
+    CharacterTraits traits(48000, 100, 48000, 0, 1600/24);
+    Coord2D coord = std::make_pair(5, 5);
+    size_t characterID = gridWorld.AddCharacter(traits, coord);
+
+    ActorPtr actor = makeActor(gridWorld, characterID);
+    gridWorld.getCharacter(characterID)->setActionPolicy(actor);
+}
+
+// replaces the state of the world with a snapshot written by WorldSnapshot::save
+inline void restoreWorld(GridWorld& gridWorld, const WorldSnapshot& snapshot) {
+    snapshot.restore(gridWorld, makeActor);
+}
+
+#endif // APP_COMMON_HPP
@@ -0,0 +1,98 @@
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "simulation.hpp"
+#include "app_common.hpp"
+
+// snapshot file of world k
+static std::string snapshotPath(const std::string& base, size_t k) {
+    return base + "." + std::to_string(k);
+}
+
+// Runs the simulation without a window, stepping as fast as the model allows.
+// Stops after Data.max_time simulated hours (or when every character is dead).
+// Data.num_worlds independent worlds are stepped side by side, world k is
+// seeded with GridWorld.randomSeed + k.
+//
+// With Data.checkpoint set, world k is saved to <checkpoint>.k every
+// Data.checkpoint_interval simulated hours (0 for only at the end). With
+// Data.resume set, the worlds are restored from <resume>.k instead of being
+// generated and the run continues from the time they were saved at.
+int main(int argc, char** argv) {
+    loadConfigFiles(argc, argv);
+    openDataFile();
+
+    data_management::ParamReader& reader = data_management::ParamReader::getInstance();
+    const size_t numWorlds = reader.getParam<size_t>("Data", "num_worlds", 1);
+    const size_t width = reader.getParam<size_t>("GridWorld", "width", 10);
+    const size_t height = reader.getParam<size_t>("GridWorld", "height", 10);
+    const size_t randomSeed = reader.getParam<size_t>("GridWorld", "randomSeed", 0);
+    const double maxTime = reader.getParam<double>("Data", "max_time", 0);
+    const double frameTime = reader.getParam<double>("Data", "frame_time", 1.0);
+    const std::string checkpointPath = reader.getParam<std::string>("Data", "checkpoint", "");
+    const double checkpointInterval = reader.getParam<double>("Data", "checkpoint_interval", 0);
+    const std::string resumePath = reader.getParam<std::string>("Data", "resume", "");
+    if (maxTime <= 0) {
+        std::cerr << "Data.max_time must be positive for a headless run" << std::endl;
+        return 1;
+    }
+
+    Simulation simulation(frameTime);
+    std::shared_ptr<ThreadPool> threadPool = makeThreadPool();
+    std::vector<std::unique_ptr<GridWorld>> worlds;
+    auto restoreStart = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < numWorlds; k++) {
+        if (resumePath.empty()) {
+            worlds.push_back(std::make_unique<GridWorld>(width, height, randomSeed + k));
+            worlds.back()->setThreadPool(threadPool);
+            setupWorld(*worlds.back());
+        } else {
+            WorldSnapshot snapshot(snapshotPath(resumePath, k));
+            worlds.push_back(std::make_unique<GridWorld>(snapshot.getWidth(), snapshot.getHeight(), snapshot.getRandomSeed()));
+            worlds.back()->setThreadPool(threadPool);
+            restoreWorld(*worlds.back(), snapshot);
+            if (k == 0) {
+                simulation.resume(snapshot.getTimeElapsed(), snapshot.getTick());
+            }
+        }
+        simulation.addWorld(*worlds.back());
+    }
+    if (!resumePath.empty()) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - restoreStart).count();
+        std::cout << "Resumed " << numWorlds << " world(s) at " << simulation.getTimeElapsed()
+                  << " hours in " << seconds << " s" << std::endl;
+    }
+
+    auto saveCheckpoint = [&]() {
+        for (size_t k = 0; k < numWorlds; k++) {
+            WorldSnapshot::save(*worlds[k], simulation.getTimeElapsed(), snapshotPath(checkpointPath, k));
+        }
+    };
+
+    const size_t startTick = simulation.getTickCount();
+    double nextCheckpoint = simulation.getTimeElapsed() + checkpointInterval;
+    auto start = std::chrono::steady_clock::now();
+    while (simulation.getTimeElapsed() < maxTime) {
+        if (!simulation.step()) {
+            break;
+        }
+        if (!checkpointPath.empty() && checkpointInterval > 0 && simulation.getTimeElapsed() >= nextCheckpoint) {
+            saveCheckpoint();
+            nextCheckpoint += checkpointInterval;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (!checkpointPath.empty()) {
+        saveCheckpoint();
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    size_t ticks = simulation.getTickCount() - startTick;
+    std::cout << "Simulated " << ticks << " ticks (" << simulation.getTimeElapsed()
+              << " hours) of " << numWorlds << " world(s) in " << seconds << " s: "
+              << (seconds > 0 ? ticks / seconds : 0.0) << " ticks/sec" << std::endl;
+
+    data_management::DataWriter::getInstance().closeFile();
+    return 0;
+}
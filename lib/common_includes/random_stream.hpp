@@ -0,0 +1,111 @@
+#ifndef COMMON_INCLUDES_RANDOM_STREAM_HPP
+#define COMMON_INCLUDES_RANDOM_STREAM_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+// A keyed bijection on 128 bit counters: equal (counter, key) always give the
+// same output and distinct counters give independent looking outputs, so
+// random numbers can be addressed instead of drawn in sequence.
+class Philox4x32 {
+public:
+  typedef std::array<uint32_t, 4> Counter;
+  typedef std::array<uint32_t, 2> Key;
+
+  static Counter generate(Counter counter, Key key) {
+    for (int round = 0; round < 10; round++) {
+      if (round > 0) {
+        key[0] += 0x9E3779B9;
+        key[1] += 0xBB67AE85;
+      }
+      uint64_t product0 = static_cast<uint64_t>(0xD2511F53) * counter[0];
+      uint64_t product1 = static_cast<uint64_t>(0xCD9E8D57) * counter[2];
+      counter = Counter{static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                        static_cast<uint32_t>(product1),
+                        static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                        static_cast<uint32_t>(product0)};
+    }
+    return counter;
+  }
+};
+
+// what a stream is used for, streams of different purposes never overlap
+enum class RandomPurpose : uint32_t {
+  MapGeneration = 1,
+  ActionSelection = 2,
+  ConflictResolution = 3,
+  Rollout = 4,
+  MapNoise = 5
+};
+
+// The random numbers of one (seed, entity, tick, purpose) stream. Streams
+// are independent of each other and of the order in which they are created
+// or consumed, so entities can draw in parallel and runs stay bit for bit
+// reproducible. Entity and tick are used modulo 2^32, a stream holds 2^34
+// values. Satisfies UniformRandomBitGenerator.
+class RandomStream {
+public:
+  typedef uint32_t result_type;
+
+  RandomStream(uint64_t seed, uint64_t entity, uint64_t tick, RandomPurpose purpose)
+      : key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+        counter{0, static_cast<uint32_t>(purpose), static_cast<uint32_t>(tick), static_cast<uint32_t>(entity)} {}
+
+  static constexpr result_type min() {
+    return 0;
+  }
+
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() {
+    if (used == block.size()) {
+      block = Philox4x32::generate(counter, key);
+      counter[0]++;
+      used = 0;
+    }
+    return block[used++];
+  }
+
+  // uniform in [0, 1) with 53 random bits
+  double uniform() {
+    uint64_t high = (*this)() >> 5;
+    uint64_t low = (*this)() >> 6;
+    return (high * 67108864.0 + low) / 9007199254740992.0;
+  }
+
+  // uniform in [0, n), n > 0
+  size_t below(size_t n) {
+    return static_cast<size_t>(uniform() * n);
+  }
+
+  // index drawn with probability proportional to weights[i], the weights need
+  // not be normalised. Returns count - 1 if rounding leaves the draw past the end.
+  template <class T>
+  size_t choose(const T* weights, size_t count) {
+    double total = 0;
+    for (size_t i = 0; i < count; i++) {
+      total += weights[i];
+    }
+    double target = uniform() * total;
+    for (size_t i = 0; i < count; i++) {
+      target -= weights[i];
+      if (target < 0) {
+        return i;
+      }
+    }
+    return count - 1;
+  }
+
+private:
+  Philox4x32::Key key;
+  Philox4x32::Counter counter;
+  Philox4x32::Counter block{};
+  size_t used = 4;
+};
+
+#endif // COMMON_INCLUDES_RANDOM_STREAM_HPP
@@ -0,0 +1,183 @@
+#ifndef COMMON_INCLUDES_THREAD_POOL_HPP
+#define COMMON_INCLUDES_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool for data-parallel loops. parallelFor splits an index
+// range into chunks that are dealt out to per-worker deques; a worker drains
+// its own deque from the back and steals from the front of the others once it
+// runs dry. The calling thread helps out until the whole range is done.
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t numThreads)
+      : queues(numThreads > 0 ? numThreads : 1) {
+    for (size_t i = 0; i < queues.size(); i++) {
+      queues[i] = std::make_unique<WorkQueue>();
+    }
+    for (size_t i = 0; i < queues.size(); i++) {
+      workers.emplace_back([this, i]() { workerLoop(i); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping = true;
+    }
+    wakeup.notify_all();
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t size() const {
+    return workers.size();
+  }
+
+  // calls body(i) for every i in [0, count), returns once all calls finished.
+  // The first exception thrown by body is rethrown here.
+  void parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+      return;
+    }
+    Job job(body);
+    // a few chunks per worker so stealing can even out uneven work
+    size_t chunkSize = count / (queues.size() * 4);
+    if (chunkSize == 0) {
+      chunkSize = 1;
+    }
+    size_t numChunks = (count + chunkSize - 1) / chunkSize;
+    job.remaining.store(numChunks);
+
+    for (size_t c = 0; c < numChunks; c++) {
+      size_t begin = c * chunkSize;
+      size_t end = begin + chunkSize < count ? begin + chunkSize : count;
+      WorkQueue& queue = *queues[c % queues.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.tasks.push_back(Task{&job, begin, end});
+    }
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      queuedTasks += numChunks;
+    }
+    wakeup.notify_all();
+
+    // help until there is nothing left to take, then wait for stragglers
+    Task task;
+    while (job.remaining.load() > 0 && steal(0, task)) {
+      run(task);
+    }
+    std::unique_lock<std::mutex> lock(job.mutex);
+    job.done.wait(lock, [&job]() { return job.remaining.load() == 0; });
+    if (job.error) {
+      std::rethrow_exception(job.error);
+    }
+  }
+
+private:
+  struct Job {
+    explicit Job(const std::function<void(size_t)>& body) : body(body) {}
+    const std::function<void(size_t)>& body;
+    std::atomic<size_t> remaining{0};
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+  };
+
+  struct Task {
+    Job* job = nullptr;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void workerLoop(size_t index) {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeup.wait(lock, [this]() { return stopping || queuedTasks > 0; });
+        if (stopping && queuedTasks == 0) {
+          return;
+        }
+      }
+      Task task;
+      if (popOwn(index, task) || steal(index, task)) {
+        run(task);
+      }
+    }
+  }
+
+  bool popOwn(size_t index, Task& task) {
+    WorkQueue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    taken();
+    return true;
+  }
+
+  bool steal(size_t start, Task& task) {
+    for (size_t k = 0; k < queues.size(); k++) {
+      WorkQueue& queue = *queues[(start + k) % queues.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tasks.empty()) {
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+        taken();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void taken() {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    queuedTasks--;
+  }
+
+  static void run(const Task& task) {
+    Job& job = *task.job;
+    try {
+      for (size_t i = task.begin; i < task.end; i++) {
+        job.body(i);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(job.mutex);
+      if (!job.error) {
+        job.error = std::current_exception();
+      }
+    }
+    std::lock_guard<std::mutex> lock(job.mutex);
+    if (--job.remaining == 0) {
+      job.done.notify_all();
+    }
+  }
+
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+  std::vector<std::thread> workers;
+  std::mutex sleepMutex;
+  std::condition_variable wakeup;
+  size_t queuedTasks = 0;
+  bool stopping = false;
+};
+
+#endif // COMMON_INCLUDES_THREAD_POOL_HPP
@@ -3,20 +3,22 @@
 
 #include <SFML/Graphics.hpp>
 #include "gridworld_view.hpp"
+#include "simulation.hpp"
+
+class GridWorld;
 
 class GridWorldController {
 public:
-    GridWorldController(GridWorldView& view, double frameTime = 1.0);
+    GridWorldController(GridWorld& model, GridWorldView& view, double frameTime = 1.0);
     void handleInput(sf::RenderWindow& window);
     bool update();
 
 private:
     GridWorldView& view;
     // hours per frame
-    const double frameTime;
+    Simulation simulation;
     const double frameRate = 10.0;
-    double timeAccumulator = 0.0;
     sf::Clock clock;
 };
 
-#endif // GRIDWORLD_CONTROLLER_HPP
\ No newline at end of file
+#endif // GRIDWORLD_CONTROLLER_HPP
@@ -3,13 +3,16 @@
 
 #include <SFML/Graphics.hpp>
 
+class GridWorld;
+
 class GridWorldView {
 public:
-    GridWorldView();
+    GridWorldView(const GridWorld& model);
     void draw(sf::RenderWindow& window);
     void setTimeElapsed(float timeElapsed);
 
 private:
+    const GridWorld& model;
     // size of character dots
     const float characterSize = 10.0f;
     const float characterSpacing = 2.0f;
@@ -1,11 +1,10 @@
 #include "gridworld_controller.hpp"
 
-#include "gridworld.hpp"
-#include "data_writer.hpp"
-
-GridWorldController::GridWorldController(GridWorldView& view, double frameTime) :
+GridWorldController::GridWorldController(GridWorld& model, GridWorldView& view, double frameTime) :
     view(view),
-    frameTime(frameTime) {}
+    simulation(frameTime) {
+    simulation.addWorld(model);
+}
 
 void GridWorldController::handleInput(sf::RenderWindow& window) {
     sf::Event event;
@@ -18,17 +17,11 @@ void GridWorldController::handleInput(sf::RenderWindow& window) {
 bool GridWorldController::update() {
     float frameDuration = 1.0f / frameRate;
     if (clock.getElapsedTime().asSeconds() >= frameDuration) {
-        GridWorld& model = GridWorld::getInstance();
-        data_management::DataWriter& writer = data_management::DataWriter::getInstance();
-        model.update(frameTime);
-        timeAccumulator += frameTime;
-        writer.endLine();
-        if (!model.hasLivingCharacters()) {
+        if (!simulation.step()) {
             return false;
         }
-        writer.writeData("Time Elapsed", data_management::DataType::DOUBLE, timeAccumulator);
-        view.setTimeElapsed(timeAccumulator);
+        view.setTimeElapsed(simulation.getTimeElapsed());
         clock.restart();
     }
     return true;
-}
\ No newline at end of file
+}
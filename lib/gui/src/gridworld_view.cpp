@@ -6,7 +6,8 @@
 #include "gridworld.hpp"
 #include "param_reader.hpp"
 
-GridWorldView::GridWorldView():
+GridWorldView::GridWorldView(const GridWorld& model):
+    model(model),
     max_time_elapsed(data_management::ParamReader::getInstance().getParam<float>("Data", "max_time", 0)) {}
 
 void GridWorldView::setTimeElapsed(float timeElapsed) {
@@ -18,20 +19,20 @@ void GridWorldView::draw(sf::RenderWindow& window) {
     window.close();
     return;
   }
-  const GridWorld& model = GridWorld::getInstance();
   size_t width = model.getWidth();
   size_t height = model.getHeight();
   float tileWidth = window.getSize().x / width;
   float tileHeight = window.getSize().y / height;
 
+  const TileStore& tileStore = model.getTileStore();
   for (size_t i = 0; i < width; i++) {
     for (size_t j = 0; j < height; j++) {
       sf::RectangleShape tile(sf::Vector2f(tileWidth, tileHeight));
       tile.setPosition(i * tileWidth, j * tileHeight);
 
       // Get the resources of the tile
-      const ResourceManager& resourceInfo = model.getTile({i, j})->getResourceManager();
-      float ratio = static_cast<float>(resourceInfo.resources.kcal) / static_cast<float>(resourceInfo.maxResources.kcal);
+      size_t tileID = model.getTileID({i, j});
+      float ratio = static_cast<float>(tileStore.getResources(tileID).kcal) / static_cast<float>(tileStore.getMaxResources(tileID).kcal);
 
       // Set the color of the tile based on the resources
       uint8_t r = static_cast<uint8_t>(255 * (1 - ratio) + 0.5);
@@ -46,8 +47,7 @@ void GridWorldView::draw(sf::RenderWindow& window) {
   float dot_size = 2 * characterSize + characterSpacing;
   size_t max_dots_per_tile = static_cast<size_t>(tileHeight * tileWidth / (dot_size * dot_size));
 
-  const std::unordered_map<size_t, Coord2D>& tileCoordMap = model.getTileCoordMap();
-  const std::unordered_map<size_t, std::unordered_set<size_t>>& tileCharacterMap = model.getTileCharacterMap();
+  const OccupancyIndex& occupancy = model.getOccupancy();
 
   sf::Font font;
   if (!font.loadFromFile("resources/Ubuntu-R.ttf")) {
@@ -62,10 +62,12 @@ void GridWorldView::draw(sf::RenderWindow& window) {
   // timeText.setPosition(10, 10);
   // window.draw(timeText);
 
-  for (const auto& pair : tileCharacterMap) {
-    size_t tileID = pair.first;
-    Coord2D coord = tileCoordMap.at(tileID);
-    size_t numCharacters = pair.second.size();
+  for (size_t tileID = 0; tileID < model.getTileCount(); tileID++) {
+    size_t numCharacters = occupancy.count(tileID);
+    if (numCharacters == 0) {
+      continue;
+    }
+    Coord2D coord = model.getTileCoord(tileID);
     if (numCharacters > max_dots_per_tile) {
       sf::CircleShape dot(characterSize);
       dot.setFillColor(sf::Color::Black);
@@ -86,7 +88,10 @@ void GridWorldView::draw(sf::RenderWindow& window) {
       float offsetX = (tileWidth - (gridSize - 1) * dot_size) / 2;
       float offsetY = (tileHeight - (gridSize - 1) * dot_size) / 2;
 
-      for (size_t k = 0; k < numCharacters; k++) {
+      size_t k = 0;
+      for (size_t characterID = occupancy.first(tileID);
+           characterID != OccupancyIndex::None;
+           characterID = occupancy.nextOnTile(characterID), k++) {
         size_t row = k / gridSize;
         size_t col = k % gridSize;
         sf::CircleShape dot(characterSize);
@@ -96,8 +101,6 @@ void GridWorldView::draw(sf::RenderWindow& window) {
         window.draw(dot);
 
         // Draw the character's health bar
-        // get the kth character in the unordered set
-        size_t characterID = *std::next(pair.second.begin(), k);
         constCharacterPtr character = model.getCharacter(characterID);
         const CharacterTraits& traits = character->getTraits();
         float healthRatio = traits.health / traits.max_health;
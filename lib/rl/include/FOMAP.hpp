@@ -5,36 +5,49 @@
 
 #include <torch/torch.h>
 
+#include "state_encoder.hpp"
+
 namespace rl {
 
 class FOMAP : public torch::nn::Module {
 public:
-  FOMAP();
+  // keys and values of a state for the action queries to attend over
+  typedef StateEncoderImpl::Encoding Memory;
+
+  // without an encoder of its own, only encodings made elsewhere can be scored
+  FOMAP(bool own_encoder = true);
+
+  size_t getProjectionSize() const {
+    return projection_size;
+  }
+
+  // probabilities of the actions, [actions, 1]
   torch::Tensor forward(torch::Tensor grid_state,
                         torch::Tensor tile_state,
                         torch::Tensor character_state,
                         torch::Tensor actions);
 
+  // project a state once for any number of score calls, incrementally when
+  // given the world it was observed from
+  Memory encode(torch::Tensor grid_state,
+                torch::Tensor tile_state,
+                torch::Tensor character_state,
+                const GridWorld* world = nullptr);
+
+  // unnormalised log probability of every action row, [actions, 1]. Rows do
+  // not depend on each other, so the actions of several characters can be
+  // scored in one call and normalised separately.
+  torch::Tensor score(const Memory& memory, torch::Tensor actions);
+
 private:
   size_t projection_size;
   size_t output_size;
-  size_t grid_state_size;
-  size_t tile_state_size;
-  size_t character_state_size;
   size_t action_size;
 
-  torch::nn::Linear grid_state_projection;
-  torch::nn::Linear tile_state_projection;
-  torch::nn::Linear character_state_projection;
+  StateEncoder encoder;
 
   // multi head attention
   torch::nn::Linear query_actions;
-  torch::nn::Linear key_grid_state_projection;
-  torch::nn::Linear key_tile_state_projection;
-  torch::nn::Linear key_character_state_projection;
-  torch::nn::Linear value_grid_state_projection;
-  torch::nn::Linear value_tile_state_projection;
-  torch::nn::Linear value_character_state_projection;
 
   torch::nn::Linear grid_weight;
   torch::nn::Linear tile_weight;
@@ -4,41 +4,39 @@
 #include <vector>
 #include <torch/torch.h>
 
+#include "state_encoder.hpp"
+
 namespace rl {
 
 class StateValueEstimator : public torch::nn::Module {
 public:
-  // Constructor
-  StateValueEstimator();
+  // Constructor, without an encoder of its own only encodings made
+  // elsewhere can be evaluated
+  StateValueEstimator(bool own_encoder = true);
 
   // Destructor
   ~StateValueEstimator();
 
-  // Forward pass
+  // Forward pass, incremental when given the world the state was observed from
   torch::Tensor forward(torch::Tensor grid_state,
                         torch::Tensor tile_state,
-                        torch::Tensor character_state);
+                        torch::Tensor character_state,
+                        const GridWorld* world = nullptr);
+
+  size_t getProjectionSize() const {
+    return projection_size;
+  }
+
+  // value of an encoded state
+  torch::Tensor evaluate(const StateEncoderImpl::Encoding& encoding);
 
 private:
   size_t projection_size;
-  size_t grid_state_size;
-  size_t tile_state_size;
-  size_t char_state_size;
 
-  torch::nn::Linear grid_state_projection;
-  torch::nn::Linear tile_state_projection;
-  torch::nn::Linear char_state_projection;
+  StateEncoder encoder;
 
   torch::nn::Linear query;
 
-  torch::nn::Linear key_grid_weights;
-  torch::nn::Linear key_tile_weights;
-  torch::nn::Linear key_char_weights;
-
-  torch::nn::Linear value_grid_weights;
-  torch::nn::Linear value_tile_weights;
-  torch::nn::Linear value_char_weights;
-
   torch::nn::Linear grid_weight;
   torch::nn::Linear tile_weight;
   torch::nn::Linear char_weight;
@@ -4,46 +4,54 @@
 #include "abstract_actor.hpp"
 #include "character.hpp"
 #include "gridworld.hpp"
-#include "StateValueEstimator.hpp"
-#include "FOMAP.hpp"
+#include "smart_policy.hpp"
 
+#include <memory>
 #include <vector>
 
 namespace rl {
 
-typedef torch::autograd::variable_list Parameters;
-
+// Acts for one character with a SmartPolicy, its own or the one shared by
+// the population of the world (see SmartPolicy::forWorld). Only the last
+// decision of the character is kept per actor.
 class SmartActor : public AbstractActor {
+  friend class SmartPolicy;
 static const size_t ElementID = 5;
 public:
-  SmartActor();
+  SmartActor(GridWorld& world);
+
+  ~SmartActor();
 
   void update(double reward) override;
 
+  // a batch of one through the policy
   size_t selectAction(const std::vector<ActionDesc>& actions) override;
 
+  // only a shared policy batches, an actor with a policy of its own decides
+  // on its own in the parallel decide phase
+  DecisionBatch* getDecisionBatch() override {
+    return policy->isShared() ? policy.get() : nullptr;
+  }
+
+  // the policy, written by one of the actors sharing it
+  void save(std::ostream& out) const override;
+  void load(std::istream& in) override;
+
 private:
-  GridWorld& world; // Global reference object
-  StateValueEstimator v; // State value estimator
-  FOMAP fomap; // Fully Observable Markovian Action Policy
+  // the policy's decision for this actor, recorded in the data file once the
+  // actor learns from it, in the serial update phase
+  void decided(size_t character, torch::Tensor state_value, torch::Tensor action_probs, size_t action_index, size_t action_id);
 
-  size_t randomSeed; // Random seed for the actor
-  std::default_random_engine randomEngine; // Random engine for the actor
+  std::shared_ptr<SmartPolicy> policy; // Networks and optimizers
 
-  torch::Tensor last_action_prob; // Probability of the last action
+  torch::Tensor last_action_prob; // Probability of the last action, undefined once learned from
   torch::Tensor last_state_value; // Value of the last state
-  const double discounting_factor; // Discounting factor for future rewards
-  const double learning_rate_actor; // Learning rate for the actor
-  const double learning_rate_critic; // Learning rate for the critic
-  const double elibility_decay_actor; // Decay factor for the actor eligibility traces
-  const double elibility_decay_critic; // Decay factor for the critic eligibility traces
-
-  // stochastic gradient descent
-  torch::optim::Adam optimizer_actor;
-  torch::optim::RMSprop optimizer_critic;
-
-  Parameters actor_eligibility_trace;
-  Parameters critic_eligibility_trace;
+
+  // the rest of the last decision, for the data file
+  size_t character = 0; // Instance ID of the character acted for
+  torch::Tensor last_action_probs; // Probabilities of every offered action
+  size_t last_action_index = 0; // Index of the last action among the offered ones
+  size_t last_action_id = 0; // ActionID of the last action
 };
 
 } // namespace rl
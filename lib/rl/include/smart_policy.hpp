@@ -0,0 +1,146 @@
+#ifndef SMART_POLICY_HPP
+#define SMART_POLICY_HPP
+
+#include "abstract_actor.hpp"
+#include "gridworld.hpp"
+#include "StateValueEstimator.hpp"
+#include "FOMAP.hpp"
+
+#include <istream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace rl {
+
+class SmartActor;
+
+typedef torch::autograd::variable_list Parameters;
+
+// The networks, optimizers and eligibility traces behind SmartActors, and
+// their decision batch. All actors of a batch observe the same state, so it
+// is encoded and valued once, the actions offered to every actor are scored
+// together in one pass through the policy network, and each actor then
+// samples from its own slice of the scores.
+//
+// Learning happens in rounds: every actor that decided reports its reward
+// and the TD losses of all of them are summed. Every update_interval rounds
+// the policy takes one backward pass over the summed losses and one
+// optimizer step; an interval of 0 never steps and only evaluates.
+//
+// The observations of a stamp are wrapped, valued and encoded at most once
+// while the parameters stay the same. Between steps the value of the state
+// the actors report from is the value their next decision starts from, so
+// the TD target and the next decision share one critic pass.
+//
+// With SmartActor.encoder "shared" both networks read one StateEncoder, the
+// trunk, instead of projecting the state each on their own. The trunk is
+// stepped with the actor's optimizer and eligibility trace, and receives
+// the critic's gradient scaled by SmartActor.critic_trunk_gradient, from 0
+// for a trunk trained by the actor alone to 1 for the full gradient.
+class SmartPolicy : public DecisionBatch {
+  friend class SmartActor;
+public:
+  SmartPolicy(GridWorld& world);
+
+  // a policy of its own, or the one shared by every SmartActor of the world
+  // when SmartActor.population is "shared"
+  static std::shared_ptr<SmartPolicy> forWorld(GridWorld& world);
+
+  // whether the policy is the population's
+  bool isShared() const {
+    return shared;
+  }
+
+  void selectActions(const std::vector<AbstractActor*>& actors,
+                     const std::vector<const std::vector<ActionDesc>*>& actions,
+                     std::vector<size_t>& choices) override;
+
+  // the reward of an actor's last decision, the round ends once every actor reported
+  void learn(SmartActor& actor, double reward);
+
+  // weights, optimizer state and eligibility traces of both networks
+  void save(std::ostream& out) const;
+  void load(std::istream& in);
+
+private:
+  // the current observations and what the networks made of them
+  struct Encoding {
+    size_t stamp = std::numeric_limits<size_t>::max();
+    torch::Tensor grid_state;
+    torch::Tensor tile_state;
+    torch::Tensor character_state;
+    // computed with the parameters after this many steps, undefined until needed
+    size_t steps = 0;
+    torch::Tensor value;
+    FOMAP::Memory memory;
+  };
+
+  // the cached encoding, renewed when the stamp or the parameters changed
+  Encoding& encoding();
+
+  // the keys and values of a state, from the trunk when shared
+  FOMAP::Memory encode(const Encoding& state);
+
+  // the value of a state, encoding it first when the trunk is shared
+  torch::Tensor evaluate(Encoding& state);
+
+  // the encoding as the critic sees it, its gradient into the trunk scaled
+  FOMAP::Memory criticView(const FOMAP::Memory& memory) const;
+
+  // once every actor of the round reported
+  void endRound();
+
+  // backpropagate the summed losses and step both optimizers
+  void step();
+
+  GridWorld& world; // World the actors observe
+  StateEncoder trunk; // Encoder shared by both networks, empty when separate
+  StateValueEstimator v; // State value estimator
+  FOMAP fomap; // Fully Observable Markovian Action Policy
+
+  const double discounting_factor; // Discounting factor for future rewards
+  const double learning_rate_actor; // Learning rate for the actor
+  const double learning_rate_critic; // Learning rate for the critic
+  const double elibility_decay_actor; // Decay factor for the actor eligibility traces
+  const double elibility_decay_critic; // Decay factor for the critic eligibility traces
+  const size_t update_interval; // Rounds per optimizer step, 0 for none
+  const double critic_trunk_gradient; // Share of the critic gradient the trunk receives
+
+  // stepped by each optimizer, the trunk counts as the actor's
+  Parameters actor_parameters;
+  Parameters critic_parameters;
+
+  // stochastic gradient descent
+  torch::optim::Adam optimizer_actor;
+  torch::optim::RMSprop optimizer_critic;
+
+  // over the summed gradient of the population, one copy of the parameters each
+  Parameters actor_eligibility_trace;
+  Parameters critic_eligibility_trace;
+
+  bool shared = false;
+  // actors using the policy, in the order they were created
+  std::vector<SmartActor*> actors;
+
+  // the current round: decisions made, rewards reported and value of the
+  // state the actors are in
+  size_t pending = 0;
+  size_t reported = 0;
+  torch::Tensor current_value;
+  // rounds and steps so far, losses summed since the last step
+  size_t rounds = 0;
+  size_t steps = 0;
+  torch::Tensor critic_loss;
+  torch::Tensor actor_loss;
+
+  Encoding cache;
+
+  // decide phase buffer, the offered actions of every actor one after another
+  std::vector<float> action_features;
+};
+
+} // namespace rl
+
+#endif // SMART_POLICY_HPP
@@ -0,0 +1,72 @@
+#ifndef STATE_ENCODER_HPP
+#define STATE_ENCODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <torch/torch.h>
+
+#include "gridworld.hpp"
+
+namespace rl {
+
+// Projects a state into the keys and values the networks attend over.
+//
+// Tiles are encoded row by row and only a few of them change between ticks,
+// so the tile keys and values of the last call are kept. Given the world the
+// tiles were observed from, only the rows it reports changed since then are
+// projected again and copied over the kept ones. Everything is recomputed
+// when the world cannot tell, the tile parameters were updated, or gradients
+// were switched on or off in between.
+class StateEncoderImpl : public torch::nn::Module {
+public:
+  // keys and values of a state, a row per grid, tile or character
+  struct Encoding {
+    torch::Tensor key_grid;
+    torch::Tensor key_tile;
+    torch::Tensor key_character;
+    torch::Tensor value_grid;
+    torch::Tensor value_tile;
+    torch::Tensor value_character;
+  };
+
+  StateEncoderImpl(size_t projection_size);
+
+  // world, when not nullptr, is where tile_state was observed at its current stamp
+  Encoding forward(torch::Tensor grid_state,
+                   torch::Tensor tile_state,
+                   torch::Tensor character_state,
+                   const GridWorld* world = nullptr);
+
+private:
+  // project the tiles into encoding, reusing the kept rows where possible
+  void encodeTiles(torch::Tensor tile_state, const GridWorld* world, Encoding& encoding);
+
+  // grows with every in-place update of the tile parameters
+  int64_t tileVersion() const;
+
+  torch::nn::Linear grid_state_projection;
+  torch::nn::Linear tile_state_projection;
+  torch::nn::Linear character_state_projection;
+
+  torch::nn::Linear key_grid_state_projection;
+  torch::nn::Linear key_tile_state_projection;
+  torch::nn::Linear key_character_state_projection;
+  torch::nn::Linear value_grid_state_projection;
+  torch::nn::Linear value_tile_state_projection;
+  torch::nn::Linear value_character_state_projection;
+
+  // tile keys and values of the last call and what they were computed from
+  torch::Tensor tile_keys;
+  torch::Tensor tile_values;
+  size_t tile_stamp = SIZE_MAX;
+  int64_t tile_version = -1;
+  bool tile_grad = false;
+  std::vector<int64_t> changed_rows;
+};
+
+TORCH_MODULE(StateEncoder);
+
+} // namespace rl
+
+#endif // STATE_ENCODER_HPP
\ No newline at end of file
@@ -0,0 +1,358 @@
+#include "smart_policy.hpp"
+#include "smart_actor.hpp"
+#include <torch/torch.h>
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "param_reader.hpp"
+#include "data_writer.hpp"
+#include "random_stream.hpp"
+
+using namespace rl;
+using namespace data_management;
+
+namespace {
+// the encoder both networks share, or an empty one when each has its own
+StateEncoder makeTrunk() {
+  std::string encoder = data_management::ParamReader::getInstance().getParam<std::string>("SmartActor", "encoder", "separate");
+  if (encoder == "separate") {
+    return StateEncoder(nullptr);
+  } else if (encoder != "shared") {
+    throw std::invalid_argument("Unknown SmartActor encoder: " + encoder);
+  }
+  return StateEncoder(data_management::ParamReader::getInstance().getParam<size_t>("FOMAP", "projection_size", 1024));
+}
+
+Parameters withTrunk(Parameters parameters, const StateEncoder& trunk) {
+  if (!trunk.is_empty()) {
+    for (const auto& param : trunk->parameters()) {
+      parameters.push_back(param);
+    }
+  }
+  return parameters;
+}
+}
+
+SmartPolicy::SmartPolicy(GridWorld& world) :
+    world(world),
+    trunk(makeTrunk()),
+    v(StateValueEstimator(trunk.is_empty())),
+    fomap(FOMAP(trunk.is_empty())),
+    discounting_factor(data_management::ParamReader::getInstance().getParam<double>("SmartActor", "discounting_factor", 0.99)),
+    learning_rate_actor(data_management::ParamReader::getInstance().getParam<double>("SmartActor", "learning_rate_actor", 0.01)),
+    learning_rate_critic(data_management::ParamReader::getInstance().getParam<double>("SmartActor", "learning_rate_critic", 0.01)),
+    elibility_decay_actor(data_management::ParamReader::getInstance().getParam<double>("SmartActor", "elibility_decay_actor", 0.99)),
+    elibility_decay_critic(data_management::ParamReader::getInstance().getParam<double>("SmartActor", "elibility_decay_critic", 0.99)),
+    update_interval(data_management::ParamReader::getInstance().getParam<size_t>("SmartActor", "update_interval", 1)),
+    critic_trunk_gradient(data_management::ParamReader::getInstance().getParam<double>("SmartActor", "critic_trunk_gradient", 1.0)),
+    actor_parameters(withTrunk(fomap.parameters(), trunk)),
+    critic_parameters(v.parameters()),
+    optimizer_actor(actor_parameters, torch::optim::AdamOptions(learning_rate_actor)),
+    optimizer_critic(critic_parameters, torch::optim::RMSpropOptions(learning_rate_critic)) {
+  if (critic_trunk_gradient < 0 || critic_trunk_gradient > 1) {
+    throw std::invalid_argument("SmartActor.critic_trunk_gradient must be in [0, 1]");
+  }
+  if (!trunk.is_empty() && fomap.getProjectionSize() != v.getProjectionSize()) {
+    throw std::invalid_argument("A shared encoder needs the same projection_size for FOMAP and StateValueEstimator");
+  }
+
+  for (const auto& param : actor_parameters) {
+    actor_eligibility_trace.push_back(torch::zeros_like(param));
+  }
+
+  for (const auto& param : critic_parameters) {
+    critic_eligibility_trace.push_back(torch::zeros_like(param));
+  }
+
+  world.enableObservations();
+}
+
+std::shared_ptr<SmartPolicy> SmartPolicy::forWorld(GridWorld& world) {
+  std::string population = data_management::ParamReader::getInstance().getParam<std::string>("SmartActor", "population", "individual");
+  if (population == "individual") {
+    return std::make_shared<SmartPolicy>(world);
+  } else if (population != "shared") {
+    throw std::invalid_argument("Unknown SmartActor population: " + population);
+  }
+  // kept while any actor of the world holds it
+  static std::mutex mutex;
+  static std::unordered_map<size_t, std::weak_ptr<SmartPolicy>> shared;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::weak_ptr<SmartPolicy>& entry = shared[world.getInstanceID()];
+  std::shared_ptr<SmartPolicy> policy = entry.lock();
+  if (!policy) {
+    policy = std::make_shared<SmartPolicy>(world);
+    policy->shared = true;
+    entry = policy;
+  }
+  return policy;
+}
+
+void SmartPolicy::selectActions(const std::vector<AbstractActor*>& actors,
+                                const std::vector<const std::vector<ActionDesc>*>& actions,
+                                std::vector<size_t>& choices) {
+  // a round left incomplete by actors that were destroyed before reporting
+  if (reported > 0 && reported == pending) {
+    endRound();
+  }
+  // a policy that never steps needs no graphs
+  torch::AutoGradMode grad_mode(update_interval > 0);
+
+  // one row per offered action of every actor, encoded without touching the
+  // tensor element by element. Cloned since backprop in update still needs it.
+  size_t action_count = 0;
+  for (const std::vector<ActionDesc>* offered : actions) {
+    action_count += offered->size();
+  }
+  action_features.resize(action_count * ActionDesc::actionSize);
+  size_t row = 0;
+  for (const std::vector<ActionDesc>* offered : actions) {
+    for (const ActionDesc& action : *offered) {
+      auto features = action.getFeatures();
+      std::copy(features.begin(), features.end(), action_features.begin() + row++ * ActionDesc::actionSize);
+    }
+  }
+  auto actions_tensor = torch::from_blob(action_features.data(), {static_cast<long int>(action_count), ActionDesc::actionSize}, torch::kFloat).clone();
+
+  // the state is the same for every actor, it is encoded and valued once
+  Encoding& state = encoding();
+  if (!state.memory.key_grid.defined()) {
+    state.memory = encode(state);
+  }
+  if (!state.value.defined()) {
+    state.value = evaluate(state);
+  }
+  auto state_value = state.value;
+  auto scores = fomap.score(state.memory, actions_tensor);
+
+  // decisions run in parallel, they are written to the data file in learn
+  choices.resize(actors.size());
+  size_t offset = 0;
+  for (size_t k = 0; k < actors.size(); k++) {
+    long int count = static_cast<long int>(actions[k]->size());
+    auto action_probs = torch::softmax(scores.narrow(0, offset, count), 0);
+    offset += count;
+
+    // weighted random selection of index, keyed by character and tick so
+    // decisions do not depend on the batch they were made in
+    const std::vector<ActionDesc>& offered = *actions[k];
+    size_t character = offered[0].SubjectInstanceID;
+    RandomStream stream(world.getRandomSeed(), character, world.getTick(), RandomPurpose::ActionSelection);
+    size_t action_index = stream.choose(action_probs.data_ptr<float>(), count);
+
+    static_cast<SmartActor*>(actors[k])->decided(character, state_value, action_probs, action_index, offered[action_index].ActionID);
+    choices[k] = action_index;
+  }
+  pending += actors.size();
+}
+
+void SmartPolicy::learn(SmartActor& actor, double reward) {
+  // nothing to learn from for an actor that has not decided since its last report
+  if (!actor.last_action_prob.defined()) {
+    return;
+  }
+  // every actor of the round is in the same state, it is valued once
+  if (!current_value.defined()) {
+    Encoding& state = encoding();
+    bool stepping = update_interval > 0 && (rounds + 1) % update_interval == 0;
+    if (!state.value.defined() && !stepping) {
+      // the parameters stay as they are until the next decision, which
+      // starts from this value
+      torch::AutoGradMode grad_mode(update_interval > 0);
+      state.value = evaluate(state);
+    }
+    if (state.value.defined()) {
+      current_value = state.value.detach();
+    } else {
+      torch::NoGradGuard no_grad;
+      current_value = evaluate(state);
+    }
+  }
+  // Calculate the TD error
+  auto td_error = reward + discounting_factor * current_value - actor.last_state_value;
+
+  // actors learn one after another in character order, each in columns of its own
+  std::string name = Character::getDataLabel(world.getInstanceID(), actor.character);
+  std::vector<double> action_probs_vec;
+  for (long int i = 0; i < actor.last_action_probs.size(0); i++) {
+    action_probs_vec.push_back(actor.last_action_probs[i].item<double>());
+  }
+  DataWriter& writer = DataWriter::getInstance();
+  writer.writeData<double>((name + " State Value").c_str(), DataType::DOUBLE, actor.last_state_value.item<double>());
+  writer.writeData<std::vector<double>>((name + " Action Probabilities").c_str(), DataType::VECTOR, action_probs_vec);
+  writer.writeData<size_t>((name + " Selected Action Index").c_str(), DataType::SIZE, actor.last_action_index);
+  writer.writeData<size_t>((name + " Selected Action ID").c_str(), DataType::SIZE, actor.last_action_id);
+  writer.writeData<double>((name + " Estimated Current Value").c_str(), DataType::DOUBLE, current_value.item<double>());
+  writer.writeData<double>((name + " Reward").c_str(), DataType::DOUBLE, reward);
+  writer.writeData<double>((name + " TD Error").c_str(), DataType::DOUBLE, td_error.item<double>());
+
+  // losses of the value estimator and the FOMAP, summed until the next step
+  if (update_interval > 0) {
+    auto v_loss = td_error.pow(2);
+    auto action_loss = -torch::log(actor.last_action_prob) * td_error.detach();
+    critic_loss = critic_loss.defined() ? critic_loss + v_loss : v_loss;
+    actor_loss = actor_loss.defined() ? actor_loss + action_loss : action_loss;
+  }
+  actor.last_action_prob = torch::Tensor();
+  actor.last_state_value = torch::Tensor();
+  actor.last_action_probs = torch::Tensor();
+
+  if (++reported == pending) {
+    endRound();
+  }
+}
+
+SmartPolicy::Encoding& SmartPolicy::encoding() {
+  if (cache.stamp != world.getObservationStamp()) {
+    cache = Encoding();
+    cache.stamp = world.getObservationStamp();
+    // Wrap the world's observation buffers, they stay valid until the state
+    // computed from them has been backpropagated in the next update. Losses
+    // kept over several rounds outlive the buffers and need copies.
+    cache.grid_state = torch::from_blob(const_cast<float*>(world.getGridObservation()), {1, GridWorld::FeatureSize}, torch::kFloat);
+    cache.tile_state = torch::from_blob(const_cast<float*>(world.getTileObservations()), {static_cast<long int>(world.getTileCount()), Tile::FeatureSize}, torch::kFloat);
+    cache.character_state = torch::from_blob(const_cast<float*>(world.getCharacterObservations()), {static_cast<long int>(world.getCharacterCount()), Character::FeatureSize}, torch::kFloat);
+    if (update_interval > 1) {
+      cache.grid_state = cache.grid_state.clone();
+      cache.tile_state = cache.tile_state.clone();
+      cache.character_state = cache.character_state.clone();
+    }
+    cache.steps = steps;
+  }
+  if (cache.steps != steps) {
+    cache.value = torch::Tensor();
+    cache.memory = FOMAP::Memory();
+    cache.steps = steps;
+  }
+  return cache;
+}
+
+FOMAP::Memory SmartPolicy::encode(const Encoding& state) {
+  if (trunk.is_empty()) {
+    return fomap.encode(state.grid_state, state.tile_state, state.character_state, &world);
+  }
+  return trunk->forward(state.grid_state, state.tile_state, state.character_state, &world);
+}
+
+torch::Tensor SmartPolicy::evaluate(Encoding& state) {
+  if (trunk.is_empty()) {
+    return v.forward(state.grid_state, state.tile_state, state.character_state, &world);
+  }
+  if (!state.memory.key_grid.defined()) {
+    state.memory = encode(state);
+  }
+  return v.evaluate(criticView(state.memory));
+}
+
+FOMAP::Memory SmartPolicy::criticView(const FOMAP::Memory& memory) const {
+  if (critic_trunk_gradient == 1.0 || !torch::GradMode::is_enabled()) {
+    return memory;
+  }
+  // same values, the gradient passes through the first term only
+  auto mix = [this](const torch::Tensor& tensor) {
+    if (critic_trunk_gradient == 0.0) {
+      return tensor.detach();
+    }
+    return tensor * critic_trunk_gradient + tensor.detach() * (1 - critic_trunk_gradient);
+  };
+  FOMAP::Memory view;
+  view.key_grid = mix(memory.key_grid);
+  view.key_tile = mix(memory.key_tile);
+  view.key_character = mix(memory.key_character);
+  view.value_grid = mix(memory.value_grid);
+  view.value_tile = mix(memory.value_tile);
+  view.value_character = mix(memory.value_character);
+  return view;
+}
+
+void SmartPolicy::endRound() {
+  pending = 0;
+  reported = 0;
+  current_value = torch::Tensor();
+  rounds++;
+  if (update_interval > 0 && rounds % update_interval == 0) {
+    step();
+  }
+}
+
+void SmartPolicy::step() {
+  // the heads share at most the trunk, one pass gives every parameter its
+  // gradient and a shared trunk the sum of both
+  v.zero_grad();
+  fomap.zero_grad();
+  if (!trunk.is_empty()) {
+    trunk->zero_grad();
+  }
+  (critic_loss.sum() + actor_loss.sum()).backward();
+
+  for (size_t i = 0; i < critic_parameters.size(); i++) {
+    critic_eligibility_trace[i] = elibility_decay_critic * critic_eligibility_trace[i] + critic_parameters[i].grad();
+    critic_parameters[i].grad().copy_(critic_eligibility_trace[i]);
+  }
+  optimizer_critic.step();
+
+  for (size_t i = 0; i < actor_parameters.size(); i++) {
+    actor_eligibility_trace[i] = elibility_decay_actor * actor_eligibility_trace[i] + actor_parameters[i].grad();
+    actor_parameters[i].grad().copy_(actor_eligibility_trace[i]);
+  }
+  optimizer_actor.step();
+
+  steps++;
+  critic_loss = torch::Tensor();
+  actor_loss = torch::Tensor();
+}
+
+void SmartPolicy::save(std::ostream& out) const {
+  torch::serialize::OutputArchive archive;
+  torch::serialize::OutputArchive critic, actor, critic_optimizer, actor_optimizer;
+  v.save(critic);
+  fomap.save(actor);
+  optimizer_critic.save(critic_optimizer);
+  optimizer_actor.save(actor_optimizer);
+  archive.write("critic", critic);
+  archive.write("actor", actor);
+  archive.write("critic_optimizer", critic_optimizer);
+  archive.write("actor_optimizer", actor_optimizer);
+  if (!trunk.is_empty()) {
+    torch::serialize::OutputArchive encoder;
+    trunk->save(encoder);
+    archive.write("trunk", encoder);
+  }
+  for (size_t i = 0; i < critic_eligibility_trace.size(); i++) {
+    archive.write("critic_trace_" + std::to_string(i), critic_eligibility_trace[i], true);
+  }
+  for (size_t i = 0; i < actor_eligibility_trace.size(); i++) {
+    archive.write("actor_trace_" + std::to_string(i), actor_eligibility_trace[i], true);
+  }
+  archive.save_to(out);
+}
+
+void SmartPolicy::load(std::istream& in) {
+  torch::serialize::InputArchive archive;
+  archive.load_from(in);
+  torch::serialize::InputArchive critic, actor, critic_optimizer, actor_optimizer;
+  archive.read("critic", critic);
+  archive.read("actor", actor);
+  archive.read("critic_optimizer", critic_optimizer);
+  archive.read("actor_optimizer", actor_optimizer);
+  v.load(critic);
+  fomap.load(actor);
+  optimizer_critic.load(critic_optimizer);
+  optimizer_actor.load(actor_optimizer);
+  if (!trunk.is_empty()) {
+    torch::serialize::InputArchive encoder;
+    archive.read("trunk", encoder);
+    trunk->load(encoder);
+  }
+  for (size_t i = 0; i < critic_eligibility_trace.size(); i++) {
+    archive.read("critic_trace_" + std::to_string(i), critic_eligibility_trace[i], true);
+  }
+  for (size_t i = 0; i < actor_eligibility_trace.size(); i++) {
+    archive.read("actor_trace_" + std::to_string(i), actor_eligibility_trace[i], true);
+  }
+  // nothing computed with the old parameters may be reused
+  steps++;
+}
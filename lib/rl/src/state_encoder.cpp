@@ -0,0 +1,81 @@
+#include "state_encoder.hpp"
+
+#include <algorithm>
+
+#include "tile.hpp"
+#include "character.hpp"
+
+using namespace rl;
+
+StateEncoderImpl::StateEncoderImpl(size_t projection_size) :
+    grid_state_projection(torch::nn::Linear(torch::nn::LinearOptions(GridWorld::FeatureSize, projection_size))),
+    tile_state_projection(torch::nn::Linear(torch::nn::LinearOptions(Tile::FeatureSize, projection_size))),
+    character_state_projection(torch::nn::Linear(torch::nn::LinearOptions(Character::FeatureSize, projection_size))),
+    key_grid_state_projection(torch::nn::Linear(torch::nn::LinearOptions(projection_size, projection_size))),
+    key_tile_state_projection(torch::nn::Linear(torch::nn::LinearOptions(projection_size, projection_size))),
+    key_character_state_projection(torch::nn::Linear(torch::nn::LinearOptions(projection_size, projection_size))),
+    value_grid_state_projection(torch::nn::Linear(torch::nn::LinearOptions(projection_size, projection_size))),
+    value_tile_state_projection(torch::nn::Linear(torch::nn::LinearOptions(projection_size, projection_size))),
+    value_character_state_projection(torch::nn::Linear(torch::nn::LinearOptions(projection_size, projection_size))) {
+  register_module("grid_state_projection", grid_state_projection);
+  register_module("tile_state_projection", tile_state_projection);
+  register_module("character_state_projection", character_state_projection);
+  register_module("key_grid_state_projection", key_grid_state_projection);
+  register_module("key_tile_state_projection", key_tile_state_projection);
+  register_module("key_character_state_projection", key_character_state_projection);
+  register_module("value_grid_state_projection", value_grid_state_projection);
+  register_module("value_tile_state_projection", value_tile_state_projection);
+  register_module("value_character_state_projection", value_character_state_projection);
+}
+
+StateEncoderImpl::Encoding StateEncoderImpl::forward(torch::Tensor grid_state,
+                                                     torch::Tensor tile_state,
+                                                     torch::Tensor character_state,
+                                                     const GridWorld* world) {
+  // project into shared space, GELU activation function on state projections
+  auto grid_proj = torch::gelu(this->grid_state_projection(grid_state));
+  auto char_proj = torch::gelu(this->character_state_projection(character_state));
+
+  Encoding encoding;
+  encoding.key_grid = this->key_grid_state_projection(grid_proj);
+  encoding.key_character = this->key_character_state_projection(char_proj);
+  encoding.value_grid = this->value_grid_state_projection(grid_proj);
+  encoding.value_character = this->value_character_state_projection(char_proj);
+  encodeTiles(tile_state, world, encoding);
+  return encoding;
+}
+
+void StateEncoderImpl::encodeTiles(torch::Tensor tile_state, const GridWorld* world, Encoding& encoding) {
+  const std::vector<uint32_t>* changed = world && tile_stamp != SIZE_MAX ? world->getTileChanges(tile_stamp) : nullptr;
+  bool grad = torch::GradMode::is_enabled();
+  int64_t version = tileVersion();
+  if (!changed || !tile_keys.defined() || tile_keys.size(0) != tile_state.size(0) ||
+      tile_version != version || tile_grad != grad) {
+    auto tile_proj = torch::gelu(this->tile_state_projection(tile_state));
+    tile_keys = this->key_tile_state_projection(tile_proj);
+    tile_values = this->value_tile_state_projection(tile_proj);
+  } else if (!changed->empty()) {
+    changed_rows.assign(changed->begin(), changed->end());
+    std::sort(changed_rows.begin(), changed_rows.end());
+    changed_rows.erase(std::unique(changed_rows.begin(), changed_rows.end()), changed_rows.end());
+    // kept by the graph of index_copy, so not wrapped from the scratch buffer
+    auto rows = torch::tensor(changed_rows, torch::kLong);
+    auto tile_proj = torch::gelu(this->tile_state_projection(tile_state.index_select(0, rows)));
+    // out of place, earlier encodings may still be needed for backprop
+    tile_keys = tile_keys.index_copy(0, rows, this->key_tile_state_projection(tile_proj));
+    tile_values = tile_values.index_copy(0, rows, this->value_tile_state_projection(tile_proj));
+  }
+  tile_stamp = world ? world->getObservationStamp() : SIZE_MAX;
+  tile_version = version;
+  tile_grad = grad;
+  encoding.key_tile = tile_keys;
+  encoding.value_tile = tile_values;
+}
+
+int64_t StateEncoderImpl::tileVersion() const {
+  int64_t version = 0;
+  for (const auto& module : {tile_state_projection, key_tile_state_projection, value_tile_state_projection}) {
+    version += module->weight._version() + module->bias._version();
+  }
+  return version;
+}
\ No newline at end of file
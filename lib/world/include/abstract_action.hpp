@@ -1,11 +1,16 @@
 #ifndef ABSTRACT_ACTION_HPP
 #define ABSTRACT_ACTION_HPP
 
+#include <array>
 #include <cstddef>
 #include <unordered_map>
 #include <functional>
 #include <stdexcept>
 
+#include "element.hpp"
+
+class GridWorld;
+
 struct ActionDesc {
   const static size_t actionSize = 5;
   size_t SubjectClassID;
@@ -14,10 +19,13 @@ struct ActionDesc {
   size_t ObjectClassID;
   size_t ObjectInstanceID;
   ElementBase* subject;
+  // may be null when the object is only known by ObjectInstanceID
   ElementBase* object;
+  // position in the subject's fixed action space, see ActionSpace
+  size_t slot = 0;
 
-  double* getFeatures() const {
-    static double features[actionSize];
+  std::array<double, actionSize> getFeatures() const {
+    std::array<double, actionSize> features;
     features[0] = SubjectClassID;
     features[1] = SubjectInstanceID;
     features[2] = ActionID;
@@ -29,7 +37,12 @@ struct ActionDesc {
 
 class AbstractAction {
 public:
-  using ActionFunction = std::function<void(ElementBase*, ElementBase*)>;
+  using ActionFunction = std::function<void(GridWorld&, ElementBase*, ElementBase*)>;
+  // executes all count actions of one type chosen in a tick, sorted by object
+  // and then subject. shares[i] is the fraction of the contested object
+  // granted to actions[i]. Built-in actions are dispatched statically through
+  // BuiltinActions, this registry is for actions added from outside.
+  using BatchFunction = std::function<void(GridWorld&, const ActionDesc*, const double*, size_t)>;
 
   AbstractAction() = delete;
 
@@ -37,21 +50,43 @@ public:
     getRegistry()[actionID] = func;
   }
 
-  static void execute(size_t actionID, ElementBase* subject, ElementBase* object) {
+  // actions without a batch function run one by one and ignore their shares
+  static void registerBatchAction(size_t actionID, BatchFunction func) {
+    getBatchRegistry()[actionID] = func;
+  }
+
+  static void execute(GridWorld& world, size_t actionID, ElementBase* subject, ElementBase* object) {
     auto& registry = getRegistry();
     auto it = registry.find(actionID);
     if (it != registry.end()) {
-      it->second(subject, object);
+      it->second(world, subject, object);
     } else {
       throw std::runtime_error("Action ID not found in registry");
     }
   }
 
+  static void executeBatch(GridWorld& world, size_t actionID, const ActionDesc* actions, const double* shares, size_t count) {
+    auto& registry = getBatchRegistry();
+    auto it = registry.find(actionID);
+    if (it != registry.end()) {
+      it->second(world, actions, shares, count);
+      return;
+    }
+    for (size_t i = 0; i < count; i++) {
+      execute(world, actionID, actions[i].subject, actions[i].object);
+    }
+  }
+
 private:
   static std::unordered_map<size_t, ActionFunction>& getRegistry() {
     static std::unordered_map<size_t, ActionFunction> registry;
     return registry;
   }
+
+  static std::unordered_map<size_t, BatchFunction>& getBatchRegistry() {
+    static std::unordered_map<size_t, BatchFunction> registry;
+    return registry;
+  }
 };
 
 #endif // ABSTRACT_ACTION_HPP
\ No newline at end of file
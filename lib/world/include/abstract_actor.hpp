@@ -2,42 +2,81 @@
 #define ABSTRACT_ACTOR_HPP
 
 #include <vector>
-#include <random>
 #include <memory>
+#include <istream>
+#include <ostream>
 
 #include "element.hpp"
 #include "abstract_action.hpp"
 #include "tile.hpp"
 
 #include "param_reader.hpp"
+#include "random_stream.hpp"
 
 class AbstractActor;
 
 typedef std::unique_ptr<AbstractActor> ActorPtr;
 
+// Decides for several actors in one call, for actors that share work
+// between their decisions, such as one network evaluated for all of them.
+class DecisionBatch {
+public:
+  virtual ~DecisionBatch() {}
+
+  // choices[k] is the index of the action actors[k] takes from *actions[k]
+  virtual void selectActions(const std::vector<AbstractActor*>& actors,
+                             const std::vector<const std::vector<ActionDesc>*>& actions,
+                             std::vector<size_t>& choices) = 0;
+};
+
 class AbstractActor {
 public:
+  virtual ~AbstractActor() {}
+
   virtual size_t selectAction(const std::vector<ActionDesc>& actions) = 0;
   virtual void update(double reward) = 0;
+
+  // actors returning the same batch decide together in one call to it,
+  // nullptr decides alone through selectAction
+  virtual DecisionBatch* getDecisionBatch() {
+    return nullptr;
+  }
+
+  // state to carry over a checkpoint (see WorldSnapshot), none by default
+  virtual void save(std::ostream& out) const {}
+  virtual void load(std::istream& in) {}
 };
 
 typedef std::unique_ptr<AbstractActor> ActorPtr;
 
+// Uniform over the offered actions. Decision n of a character draws from
+// the (seed, character, n) stream, so the choice does not depend on which
+// thread decides or on what other actors drew before. Character IDs are
+// numbered per world, so seed should be the world's.
 class RandomActor : public AbstractActor {
 public:
-  RandomActor() : randomEngine(data_management::ParamReader::getInstance().getParam<size_t>("GridWorld", "randomSeed", 0)) {}
+  explicit RandomActor(size_t seed) : seed(seed) {}
 
   ~RandomActor() {}
 
   size_t selectAction(const std::vector<ActionDesc>& actions) override {
-    std::uniform_int_distribution<size_t> distribution(0, actions.size() - 1);
-    return distribution(randomEngine);
+    RandomStream stream(seed, actions[0].SubjectInstanceID, decisions++, RandomPurpose::ActionSelection);
+    return stream.below(actions.size());
   }
 
   void update(double reward) {}
 
+  void save(std::ostream& out) const override {
+    out.write(reinterpret_cast<const char*>(&decisions), sizeof(decisions));
+  }
+
+  void load(std::istream& in) override {
+    in.read(reinterpret_cast<char*>(&decisions), sizeof(decisions));
+  }
+
 protected:
-  std::default_random_engine randomEngine;
+  const size_t seed;
+  size_t decisions = 0;
 };
 
 #endif // ABSTRACT_ACTOR_HPP
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef ACTION_SPACE_HPP
+#define ACTION_SPACE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "abstract_action.hpp"
+#include "grid_topology.hpp"
+
+// Bit i set when slot i of a character's action space can be taken
+typedef uint16_t ActionMask;
+
+// The same fixed set of action slots for every character: stay, one move per
+// direction of the neighbourhood, harvest. A move slot always heads the same
+// way (GridTopology::getDirections), on the edge of a bounded map the slots
+// of directions leading off it are invalid. Which slots are valid depends on
+// where the character stands and is given by a bitmask. Encoding
+// and decoding only read the topology, they allocate nothing and may run
+// from any number of threads.
+class ActionSpace {
+public:
+  static constexpr size_t Stay = 0;
+  static constexpr size_t FirstMove = 1;
+  static constexpr size_t Harvest = FirstMove + GridTopology::MaxNeighbours;
+  static constexpr size_t Size = Harvest + 1;
+  // floats per character in writeFeatures
+  static constexpr size_t FeatureSize = Size * ActionDesc::actionSize;
+
+  static ActionMask getMask(const GridTopology& topology, size_t tileID);
+
+  // action ID of the action behind slot
+  static size_t getActionID(size_t slot);
+
+  // tile the action behind slot targets, only meaningful for valid slots
+  static size_t getTarget(const GridTopology& topology, size_t tileID, size_t slot);
+
+  // ActionDesc::getFeatures of every slot, rows of invalid slots are zero
+  static void writeFeatures(const GridTopology& topology,
+                            size_t characterID,
+                            size_t tileID,
+                            float* features);
+};
+
+#endif // ACTION_SPACE_HPP
@@ -0,0 +1,42 @@
+#ifndef ACTION_TYPES_HPP
+#define ACTION_TYPES_HPP
+
+#include <cstddef>
+
+#include "abstract_action.hpp"
+#include "move_action.hpp"
+#include "harvest_action.hpp"
+
+// Compile-time registry of action types. Each type provides a static
+// ActionID and a static executeBatch kernel that runs every action of that
+// type chosen in a tick, sorted by object and then subject. Dispatch is a
+// chain of integer compares the compiler can fold, with no hashing, no
+// std::function and no RTTI. Actions that are not listed here still run
+// through the runtime registry of AbstractAction.
+template <class... Actions>
+class ActionTypes {
+public:
+  // returns false when actionID is not one of Actions
+  static bool executeBatch(GridWorld& world, size_t actionID, const ActionDesc* actions, const double* shares, size_t count) {
+    return (dispatch<Actions>(world, actionID, actions, shares, count) || ...);
+  }
+
+  static constexpr bool contains(size_t actionID) {
+    return ((actionID == Actions::ActionID) || ...);
+  }
+
+private:
+  template <class Action>
+  static bool dispatch(GridWorld& world, size_t actionID, const ActionDesc* actions, const double* shares, size_t count) {
+    if (actionID != Action::ActionID) {
+      return false;
+    }
+    Action::executeBatch(world, actions, shares, count);
+    return true;
+  }
+};
+
+// the actions every world knows, add new built-in actions here
+typedef ActionTypes<MoveAction, HarvestAction> BuiltinActions;
+
+#endif // ACTION_TYPES_HPP
@@ -2,9 +2,11 @@
 #define CHARACTER_HPP
 
 #include <memory>
+#include <string>
 
 #include "abstract_actor.hpp"
 #include "element.hpp"
+#include "slot_map.hpp"
 #include "tile.hpp"
 
 struct CharacterTraits {
@@ -27,18 +29,23 @@ struct CharacterTraits {
 };
 
 class Character;
+class CharacterStore;
 
 typedef std::shared_ptr<Character> CharacterPtr;
 typedef std::shared_ptr<const Character> constCharacterPtr;
 typedef std::weak_ptr<const Character> wCharacterPtr;
 
+// While a character lives in a world its traits and reward are kept in the
+// world's CharacterStore, the accessors below read and write through to it.
 class Character : public Element<Character> {
+  friend class CharacterStore;
 public:
   static const size_t ElementID = 4;
   static const size_t FeatureSize = 8;
 
-  Character(CharacterTraits traits) : 
-      Element<Character>(),
+  Character(size_t instanceID, CharacterTraits traits) :
+      Element<Character>(instanceID),
+      store(nullptr),
       traits(traits),
       reward(0),
       isActionSet(false) {}
@@ -47,22 +54,35 @@ public:
 
   void setActionPolicy(ActorPtr& actor_);
 
+  // metabolism of this character alone, worlds run it for all characters at
+  // once in CharacterStore::metabolize. The actor learns separately in updateActor.
   void update(double elapsedTime) override;
 
+  // record the metabolism of the last update in the data file
+  void writeMetabolismData(double kcalBurned) const;
+
+  // the prefix of a character's columns in the data file
+  static std::string getDataLabel(size_t worldID, size_t characterID);
+
+  // pass the reward collected since the last call to the actor
+  void updateActor();
+
   std::unique_ptr<double[]> getFeatures() const override;
 
-  void addResources(const Resources& resources) {
-    traits.kcal_on_hand += resources.kcal;
-  }
+  // same layout as getFeatures, written into FeatureSize floats
+  void writeFeatures(float* features) const;
+
+  void addResources(const Resources& resources);
 
   void burnKcal(double kcal);
 
+  // the character keeps the tile view it stands on alive
   void setPosition(const TilePtr tile) {
     position = tile;
   }
 
   constTilePtr getPosition() const {
-    return position.lock();
+    return position;
   }
 
   ActorPtr& getActor() {
@@ -72,13 +92,9 @@ public:
     return actor;
   }
 
-  const CharacterTraits& getTraits() const {
-    return traits;
-  }
+  CharacterTraits getTraits() const;
 
-  const double getReward() const {
-    return reward;
-  }
+  const double getReward() const;
 
   void getAvailableActions(std::vector<ActionDesc>& actions);
 
@@ -87,8 +103,19 @@ public:
   }
 
 protected:
-  wTilePtr position;
+  bool isStored() const;
+
+  void setTraits(const CharacterTraits& traits);
+
+  void setReward(double reward);
+
+  // where the state lives while the character is in a world
+  CharacterStore* store;
+  SlotHandle handle;
+
+  TilePtr position;
   ActorPtr actor;
+  // state while the character is not in a store
   CharacterTraits traits;
   double reward;
   bool isActionSet;
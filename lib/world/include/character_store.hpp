@@ -0,0 +1,115 @@
+#ifndef CHARACTER_STORE_HPP
+#define CHARACTER_STORE_HPP
+
+#include <vector>
+#include <cstddef>
+
+#include "character.hpp"
+#include "slot_map.hpp"
+
+typedef SlotHandle CharacterHandle;
+
+// The living characters of a world. Character objects sit packed in a slot
+// map, their simulation state in parallel component arrays in the same
+// dense order, so metabolism runs as one vectorised pass over all of them
+// and a death is a swap-remove in every array.
+//
+// A character that is not in a store (not yet added, or dead) keeps its state
+// in the Character object itself; erasing copies the final state back.
+class CharacterStore {
+public:
+  ~CharacterStore();
+
+  // takes over the state of the character
+  CharacterHandle insert(CharacterPtr character);
+
+  // swap-removes the character at row, the last one moves into its place
+  void eraseAt(size_t row);
+
+  void clear();
+
+  size_t size() const {
+    return characters.size();
+  }
+
+  bool contains(CharacterHandle handle) const {
+    return characters.contains(handle);
+  }
+
+  const SlotMap<CharacterPtr>& getCharacters() const {
+    return characters;
+  }
+
+  CharacterPtr& operator[](size_t row) {
+    return characters[row];
+  }
+
+  const CharacterPtr& operator[](size_t row) const {
+    return characters[row];
+  }
+
+  // nullptr once the character is gone
+  const CharacterPtr* get(CharacterHandle handle) const {
+    return characters.get(handle);
+  }
+
+  size_t rowOf(CharacterHandle handle) const {
+    return characters.denseIndexOf(handle);
+  }
+
+  CharacterTraits getTraits(size_t row) const {
+    return CharacterTraits(health[row], healthRegenRate[row], maxHealth[row], kcalOnHand[row], kcalBurnRate[row]);
+  }
+
+  void setTraits(size_t row, const CharacterTraits& traits);
+
+  double getReward(size_t row) const {
+    return reward[row];
+  }
+
+  void setReward(size_t row, double value) {
+    reward[row] = value;
+  }
+
+  // burn kcal_burn_rate * elapsedTime per character, taking it from health
+  // once kcal run out, then regenerate health of fed characters up to their
+  // maximum. Rows whose health dropped to 0 or below are appended to dead in
+  // ascending order.
+  void metabolize(double elapsedTime, std::vector<size_t>& dead);
+
+  // the same for a single character's state
+  static void metabolize(double& health,
+                         double& kcalOnHand,
+                         double& reward,
+                         double healthRegenRate,
+                         double maxHealth,
+                         double kcalBurnRate,
+                         double elapsedTime) {
+    double burn = kcalBurnRate * elapsedTime;
+    double deficit = burn > kcalOnHand ? burn - kcalOnHand : 0.0;
+    kcalOnHand = kcalOnHand > burn ? kcalOnHand - burn : 0.0;
+    health -= deficit;
+    reward -= deficit;
+    if (kcalOnHand > 0 && health < maxHealth) {
+      double regen = healthRegenRate * elapsedTime;
+      health += regen;
+      reward += regen;
+      if (health > maxHealth) {
+        health = maxHealth;
+      }
+    }
+  }
+
+private:
+  SlotMap<CharacterPtr> characters;
+
+  // components, one entry per character in dense order
+  std::vector<double> health;
+  std::vector<double> healthRegenRate;
+  std::vector<double> maxHealth;
+  std::vector<double> kcalOnHand;
+  std::vector<double> kcalBurnRate;
+  std::vector<double> reward;
+};
+
+#endif // CHARACTER_STORE_HPP
@@ -0,0 +1,81 @@
+#ifndef COMMAND_BUFFER_HPP
+#define COMMAND_BUFFER_HPP
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstddef>
+
+#include "abstract_action.hpp"
+
+class GridWorld;
+
+// Decides how a contested object is divided between the actions that target
+// it in the same tick. Groups arrive sorted by subject instance ID.
+class ResolutionPolicy {
+public:
+  virtual ~ResolutionPolicy() = default;
+
+  // write one share per action into shares, shares of a group sum to at most 1
+  virtual void resolve(const ActionDesc* group,
+                       size_t count,
+                       size_t tick,
+                       double* shares) const = 0;
+};
+
+// every action gets an equal part
+class SplitPolicy : public ResolutionPolicy {
+public:
+  void resolve(const ActionDesc* group, size_t count, size_t tick, double* shares) const override;
+};
+
+// the action whose subject has the lowest instance ID gets everything
+class PriorityPolicy : public ResolutionPolicy {
+public:
+  void resolve(const ActionDesc* group, size_t count, size_t tick, double* shares) const override;
+};
+
+// a single winner drawn from (seed, tick, object), the same every run
+class RandomPolicy : public ResolutionPolicy {
+public:
+  RandomPolicy(size_t seed) : seed(seed) {}
+
+  void resolve(const ActionDesc* group, size_t count, size_t tick, double* shares) const override;
+
+private:
+  const size_t seed;
+};
+
+typedef std::unique_ptr<ResolutionPolicy> ResolutionPolicyPtr;
+
+// "split", "priority" or "random", throws on anything else
+ResolutionPolicyPtr makeResolutionPolicy(const std::string& name, size_t seed);
+
+// Collects the actions chosen in a tick and applies them by type. Commands
+// are ordered by (action, object, subject) so the outcome does not depend on
+// the order in which they were pushed. Actions on the same object form a
+// group whose shares the policy decides, then each type's kernel runs once
+// over all of its actions.
+class CommandBuffer {
+public:
+  void push(const ActionDesc& action) {
+    commands.push_back(action);
+  }
+
+  void clear() {
+    commands.clear();
+  }
+
+  size_t size() const {
+    return commands.size();
+  }
+
+  // resolve conflicts and execute every action type, then empty the buffer
+  void execute(GridWorld& world, const ResolutionPolicy& policy, size_t tick);
+
+private:
+  std::vector<ActionDesc> commands;
+  std::vector<double> shares;
+};
+
+#endif // COMMAND_BUFFER_HPP
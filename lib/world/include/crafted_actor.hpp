@@ -5,14 +5,21 @@
 #include "gridworld.hpp"
 #include "character.hpp"
 
+// Harvests while the tile it stands on covers its burn rate, otherwise walks
+// down the world's ResourceField towards the nearest rich tile
 class CraftedActor : public AbstractActor {
 public:
-  CraftedActor(size_t charID);
+  // enables the resource field of world
+  CraftedActor(GridWorld& world, size_t charID);
   virtual ~CraftedActor();
 
   virtual size_t selectAction(const std::vector<ActionDesc>& actions) override;
   virtual void update(double reward) override;
 
+  // only the fallback has state
+  virtual void save(std::ostream& out) const override;
+  virtual void load(std::istream& in) override;
+
 private:
   const size_t characterID;
   const GridWorld& world;
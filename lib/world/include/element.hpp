@@ -15,8 +15,6 @@ public:
 
   virtual const size_t getInstanceID() const = 0;
 
-  virtual const size_t getInstanceCount() const = 0;
-
   virtual const size_t getFeatureSize() const = 0;
 
   virtual std::unique_ptr<double[]> getFeatures() const = 0;
@@ -40,24 +38,17 @@ public:
     return instanceID;
   }
 
-  const size_t getInstanceCount() const override {
-    return InstanceCount;
-  }
-
   const size_t getFeatureSize() const override {
     return Derived::FeatureSize;
   }
 
 protected:
-  static size_t InstanceCount;
   const size_t instanceID;
 
-  Element() : instanceID(InstanceCount++) {}
+  // instance IDs are handed out by the owning world, so every world has its own ID space
+  Element(size_t instanceID) : instanceID(instanceID) {}
 };
 
-template <class Derived>
-size_t Element<Derived>::InstanceCount = 0;
-
 // Static assertion to enforce inheritance
 template <class Derived>
 struct CheckElementInheritance {
@@ -0,0 +1,215 @@
+#ifndef GRID_TOPOLOGY_HPP
+#define GRID_TOPOLOGY_HPP
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+typedef std::pair<size_t, size_t> Coord2D;
+
+// which tiles count as adjacent
+enum class Neighbourhood {
+  // west, east, north, south
+  VonNeumann,
+  // the von Neumann tiles followed by the four diagonals
+  Moore,
+  // odd-q offset layout, odd columns sit half a tile lower
+  Hex
+};
+
+// Shape of a map, computed from tile indices instead of stored per tile.
+// Tiles are numbered column by column, ID = x * height + y. A toroidal map
+// wraps around at its edges, a bounded one has fewer neighbours there.
+// Toroidal hex maps need an even width to stay consistent across the seam,
+// the constructor throws std::invalid_argument for an odd one.
+class GridTopology {
+public:
+  static constexpr size_t MaxNeighbours = 8;
+  // a direction that leads off a bounded map
+  static constexpr size_t NoNeighbour = static_cast<size_t>(-1);
+
+  GridTopology(size_t width, size_t height, Neighbourhood neighbourhood, bool toroidal)
+      : width(width), height(height), neighbourhood(neighbourhood), toroidal(toroidal) {
+    if (neighbourhood == Neighbourhood::Hex && toroidal && width % 2 != 0) {
+      throw std::invalid_argument("Toroidal hex maps need an even width, got " + std::to_string(width));
+    }
+  }
+
+  size_t getWidth() const {
+    return width;
+  }
+
+  size_t getHeight() const {
+    return height;
+  }
+
+  size_t getTileCount() const {
+    return width * height;
+  }
+
+  Neighbourhood getNeighbourhood() const {
+    return neighbourhood;
+  }
+
+  bool isToroidal() const {
+    return toroidal;
+  }
+
+  size_t getTileID(Coord2D coord) const {
+    return coord.first * height + coord.second;
+  }
+
+  Coord2D getTileCoord(size_t tileID) const {
+    return Coord2D(tileID / height, tileID % height);
+  }
+
+  // calls f(neighbourID) for every tile adjacent to tileID, always in the same order
+  template <class F>
+  void forEachNeighbour(size_t tileID, F&& f) const {
+    switch (neighbourhood) {
+    case Neighbourhood::VonNeumann:
+      toroidal ? forEachNeighbour<Neighbourhood::VonNeumann, true>(tileID, f)
+               : forEachNeighbour<Neighbourhood::VonNeumann, false>(tileID, f);
+      break;
+    case Neighbourhood::Moore:
+      toroidal ? forEachNeighbour<Neighbourhood::Moore, true>(tileID, f)
+               : forEachNeighbour<Neighbourhood::Moore, false>(tileID, f);
+      break;
+    case Neighbourhood::Hex:
+      toroidal ? forEachNeighbour<Neighbourhood::Hex, true>(tileID, f)
+               : forEachNeighbour<Neighbourhood::Hex, false>(tileID, f);
+      break;
+    }
+  }
+
+  // the same with the layout fixed at compile time, for loops that only ever
+  // see one kind of map
+  template <Neighbourhood N, bool Toroidal, class F>
+  void forEachNeighbour(size_t tileID, F&& f) const {
+    const Offsets<N>& offsets = Offsets<N>::get(tileID / height);
+    const long x = static_cast<long>(tileID / height);
+    const long y = static_cast<long>(tileID % height);
+    const long w = static_cast<long>(width);
+    const long h = static_cast<long>(height);
+    for (const Offset& offset : offsets.values) {
+      long nx = x + offset.first;
+      long ny = y + offset.second;
+      if (Toroidal) {
+        nx = (nx + w) % w;
+        ny = (ny + h) % h;
+      } else if (nx < 0 || nx >= w || ny < 0 || ny >= h) {
+        continue;
+      }
+      f(static_cast<size_t>(nx) * height + static_cast<size_t>(ny));
+    }
+  }
+
+  // writes the neighbours of tileID into out, returns how many there are
+  size_t getNeighbours(size_t tileID, std::array<size_t, MaxNeighbours>& out) const {
+    size_t count = 0;
+    forEachNeighbour(tileID, [&out, &count](size_t neighbourID) { out[count++] = neighbourID; });
+    return count;
+  }
+
+  // writes the neighbour in every direction of the neighbourhood into out,
+  // direction i always being entry i of the offset table and NoNeighbour
+  // where it leaves a bounded map; returns the number of directions
+  size_t getDirections(size_t tileID, std::array<size_t, MaxNeighbours>& out) const {
+    switch (neighbourhood) {
+    case Neighbourhood::VonNeumann:
+      return getDirections<Neighbourhood::VonNeumann>(tileID, out);
+    case Neighbourhood::Moore:
+      return getDirections<Neighbourhood::Moore>(tileID, out);
+    case Neighbourhood::Hex:
+      return getDirections<Neighbourhood::Hex>(tileID, out);
+    }
+    return 0;
+  }
+
+  bool isAdjacent(size_t tileID, size_t otherID) const {
+    bool adjacent = false;
+    forEachNeighbour(tileID, [&adjacent, otherID](size_t neighbourID) {
+      adjacent = adjacent || neighbourID == otherID;
+    });
+    return adjacent;
+  }
+
+  // fewest steps from one tile to the other, moving between adjacent tiles
+  size_t getDistance(size_t tileID, size_t otherID) const;
+
+private:
+  typedef std::pair<int, int> Offset;
+
+  template <Neighbourhood N>
+  struct Offsets;
+
+  template <Neighbourhood N>
+  size_t getDirections(size_t tileID, std::array<size_t, MaxNeighbours>& out) const {
+    const Offsets<N>& offsets = Offsets<N>::get(tileID / height);
+    const long x = static_cast<long>(tileID / height);
+    const long y = static_cast<long>(tileID % height);
+    const long w = static_cast<long>(width);
+    const long h = static_cast<long>(height);
+    size_t direction = 0;
+    for (const Offset& offset : offsets.values) {
+      long nx = x + offset.first;
+      long ny = y + offset.second;
+      if (toroidal) {
+        nx = (nx + w) % w;
+        ny = (ny + h) % h;
+      } else if (nx < 0 || nx >= w || ny < 0 || ny >= h) {
+        out[direction++] = NoNeighbour;
+        continue;
+      }
+      out[direction++] = static_cast<size_t>(nx) * height + static_cast<size_t>(ny);
+    }
+    return direction;
+  }
+
+  const size_t width;
+  const size_t height;
+  const Neighbourhood neighbourhood;
+  const bool toroidal;
+};
+
+template <>
+struct GridTopology::Offsets<Neighbourhood::VonNeumann> {
+  std::array<Offset, 4> values;
+
+  static const Offsets& get(size_t) {
+    static constexpr Offsets offsets{{{{-1, 0}, {1, 0}, {0, -1}, {0, 1}}}};
+    return offsets;
+  }
+};
+
+template <>
+struct GridTopology::Offsets<Neighbourhood::Moore> {
+  std::array<Offset, 8> values;
+
+  static const Offsets& get(size_t) {
+    static constexpr Offsets offsets{{{{-1, 0}, {1, 0}, {0, -1}, {0, 1},
+                                       {-1, -1}, {1, -1}, {-1, 1}, {1, 1}}}};
+    return offsets;
+  }
+};
+
+template <>
+struct GridTopology::Offsets<Neighbourhood::Hex> {
+  std::array<Offset, 6> values;
+
+  static const Offsets& get(size_t column) {
+    static constexpr Offsets even{{{{-1, -1}, {1, -1}, {0, -1}, {0, 1}, {-1, 0}, {1, 0}}}};
+    static constexpr Offsets odd{{{{-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, 1}, {1, 1}}}};
+    return column % 2 ? odd : even;
+  }
+};
+
+// "vonNeumann", "moore" or "hex"
+Neighbourhood parseNeighbourhood(const std::string& name);
+
+// "torus" or "bounded"
+bool parseToroidal(const std::string& name);
+
+#endif // GRID_TOPOLOGY_HPP
@@ -1,31 +1,53 @@
 #ifndef GRIDWORLD_HPP
 #define GRIDWORLD_HPP
 
+#include <array>
 #include <vector>
 #include <unordered_map>
-#include <unordered_set>
 #include <random>
+#include <memory>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
 
 #include "element.hpp"
+#include "grid_topology.hpp"
 #include "tile.hpp"
+#include "tile_store.hpp"
 #include "character.hpp"
+#include "thread_pool.hpp"
+#include "command_buffer.hpp"
+#include "occupancy_index.hpp"
+#include "character_store.hpp"
+#include "action_space.hpp"
+#include "resource_field.hpp"
+#include "spatial_index.hpp"
 
-typedef std::pair<size_t, size_t> Coord2D;
 typedef std::reference_wrapper<ResourceManager> ResourceManagerRef;
 
+// An independent environment. Tiles and characters get their instance IDs from
+// the world that owns them, so several worlds can be stepped side by side in
+// one process.
 class GridWorld : public Element<GridWorld> {
+  friend class WorldSnapshot;
 public:
   static const size_t ElementID = 0;
   static const size_t FeatureSize = 5;
 
+  // size, seed and topology read from the GridWorld config
+  GridWorld();
+  // topology read from the GridWorld config
+  GridWorld(size_t width, size_t height, size_t randomSeed);
+  GridWorld(size_t width, size_t height, size_t randomSeed, const GridTopology& topology);
+  ~GridWorld();
+
+  // tiles and characters keep references into the world, so it stays put
+  GridWorld(const GridWorld&) = delete;
+  GridWorld& operator=(const GridWorld&) = delete;
+
   void addTilePrototypes(std::vector<ResourceManagerRef>& tile_prototypes,
                          std::vector<double>& weights);
 
-  static GridWorld& getInstance() {
-    static GridWorld instance;
-    return instance;
-  }
-
   std::unique_ptr<double[]> getFeatures() const override {
     std::unique_ptr<double[]> features(new double[FeatureSize]);
     features[0] = ElementID;
@@ -36,17 +58,65 @@ public:
     return features;
   }
 
-  std::unique_ptr<double[]> getTileFeatures() const;
+  // Keep float32 copies of the grid, tile and character features up to date
+  // at the end of every update. Only rows of tiles whose resources changed
+  // are rewritten. Off by default since the buffers are O(map size).
+  void enableObservations();
+
+  // FeatureSize floats
+  const float* getGridObservation() const {
+    return observationFrames[currentObservation].grid.data();
+  }
 
-  std::unique_ptr<double[]> getCharacterFeatures() const;
+  // getTileCount() rows of Tile::FeatureSize floats, row i is tile i
+  const float* getTileObservations() const {
+    return observationFrames[currentObservation].tiles.data();
+  }
 
-  TilePtr& getTile(Coord2D coord);
+  // getCharacterCount() rows of Character::FeatureSize floats, in the order of getCharacters()
+  const float* getCharacterObservations() const {
+    return observationFrames[currentObservation].characters.data();
+  }
 
-  TilePtr& getTile(size_t tileID);
+  // changes whenever the observations are rewritten, equal stamps mean equal observations
+  size_t getObservationStamp() const {
+    return observationStamp;
+  }
 
-  const TilePtr& getTile(Coord2D coord) const;
+  // tile rows that changed since the observations of stamp, may repeat;
+  // nullptr when not known, such as after a full rewrite
+  const std::vector<uint32_t>* getTileChanges(size_t stamp) const;
 
-  const TilePtr& getTile(size_t tileID) const;
+  // Keep a ResourceField with threshold GridWorld.resourceThreshold up to
+  // date, repaired from the tiles that changed at the end of every update.
+  // Off by default since it is O(map size).
+  void enableResourceField();
+
+  // nullptr unless enabled
+  const ResourceField* getResourceField() const {
+    return resourceField.get();
+  }
+
+  // Tile objects are views created on first use and dropped once nothing
+  // refers to them anymore, the tile state itself lives in the TileStore.
+  // Safe to call from several threads.
+  TilePtr getTile(Coord2D coord);
+
+  TilePtr getTile(size_t tileID);
+
+  constTilePtr getTile(Coord2D coord) const;
+
+  constTilePtr getTile(size_t tileID) const;
+
+  // shape of the map, tile IDs map to coordinates and neighbours arithmetically
+  const GridTopology& getTopology() const {
+    return topology;
+  }
+
+  // resource state of every tile, indexed by tile ID
+  const TileStore& getTileStore() const {
+    return tileStore;
+  }
 
   const int getWidth() const;
 
@@ -62,66 +132,177 @@ public:
     return characters.size();
   }
 
+  // lay out the prototypes over the map as the GridWorld config's mapLayout says
   void GenerateTileMap();
 
-  void AddCharacter(CharacterPtr Character, Coord2D coord);
+  // create a character on the tile at coord, returns its instance ID
+  size_t AddCharacter(CharacterTraits traits, Coord2D coord);
 
   void update(double elapsedTime) override;
 
-  const std::unordered_map<size_t, Coord2D>& getTileCoordMap() const {
-    return tileCoordMap;
+  // who stands where, by tile ID and character ID
+  const OccupancyIndex& getOccupancy() const {
+    return occupancy;
   }
 
-  const std::unordered_map<size_t, std::unordered_set<size_t>>& getTileCharacterMap() const {
-    return tileCharacterMap;
+  // radius and nearest neighbour queries over characters and tiles
+  const SpatialIndex& getSpatialIndex() const {
+    return spatialIndex;
   }
 
+  // The other characters at most radius steps from each living character,
+  // in the order of getCharacters(). Runs on the thread pool when there is one.
+  void findCharactersWithin(size_t radius, std::vector<std::vector<size_t>>& neighbours) const;
+
+  // throws std::out_of_range if there is no living character with that ID
   constCharacterPtr getCharacter(size_t characterID) const {
-    return characters.at(characterID);
+    return *characters.get(getCharacterHandle(characterID));
   }
 
   CharacterPtr getCharacter(size_t characterID) {
-    return characters.at(characterID);
+    return *characters.get(getCharacterHandle(characterID));
   }
 
-  const std::unordered_map<size_t, size_t>& getCharacterTileMap() const {
-    return characterTileMap;
+  // stays valid until the character dies
+  CharacterHandle getCharacterHandle(size_t characterID) const {
+    if (characterID >= characterHandles.size() || !characters.contains(characterHandles[characterID])) {
+      throw std::out_of_range("No living character with ID " + std::to_string(characterID));
+    }
+    return characterHandles[characterID];
+  }
+
+  // nullptr once the character died
+  const CharacterPtr* getCharacter(CharacterHandle handle) const {
+    return characters.get(handle);
+  }
+
+  // valid slots of the character's fixed action space
+  ActionMask getActionMask(size_t characterID) const;
+
+  // the action behind a valid slot of the character's action space
+  ActionDesc decodeAction(size_t characterID, size_t slot);
+
+  // ActionSpace::FeatureSize floats and one mask per living character, in
+  // the order of getCharacters(). Runs on the thread pool when there is one.
+  void writeActionFeatures(float* features, ActionMask* masks) const;
+
+  // living characters, packed; the order changes when a character dies
+  const SlotMap<CharacterPtr>& getCharacters() const {
+    return characters.getCharacters();
   }
 
   bool hasLivingCharacters() const {
-    for (const auto& character : characters) {
-      if (character.second->getTraits().health > 0) {
+    for (const CharacterPtr& character : characters.getCharacters()) {
+      if (character->getTraits().health > 0) {
         return true;
       }
     }
     return false;
   }
 
-private:
-  GridWorld();
-  ~GridWorld();
+  size_t getRandomSeed() const {
+    return randomSeed;
+  }
 
-  GridWorld(const GridWorld&) = delete;
-  GridWorld& operator=(const GridWorld&) = delete;
+  // number of completed updates
+  size_t getTick() const {
+    return tick;
+  }
+
+  // decides how contested objects are shared, GridWorld.conflictPolicy by default
+  void setResolutionPolicy(ResolutionPolicyPtr policy) {
+    resolutionPolicy = std::move(policy);
+  }
+
+  // pool used for the decide phase of update, nullptr decides serially.
+  // Worlds stepped side by side can share one pool.
+  void setThreadPool(std::shared_ptr<ThreadPool> pool) {
+    threadPool = std::move(pool);
+  }
 
+  const std::shared_ptr<ThreadPool>& getThreadPool() const {
+    return threadPool;
+  }
+
+private:
   const size_t width;
   const size_t height;
-  // grid of tiles
-  std::vector<std::vector<TilePtr>> tiles;
-  // character ID to character pointer
-  std::unordered_map<size_t, CharacterPtr> characters;
-  // tile ID to tile coordinate
-  std::unordered_map<size_t, Coord2D> tileCoordMap;
-  // character ID to tile ID
-  std::unordered_map<size_t, size_t> characterTileMap;
-  // tile ID to set of character IDs inhabiting that tile
-  std::unordered_map<size_t, std::unordered_set<size_t>> tileCharacterMap;
+  const GridTopology topology;
+  // resource state of every tile, indexed by tile ID
+  TileStore tileStore;
+  // tile views currently handed out, by tile ID
+  mutable std::unordered_map<size_t, TilePtr> tileViews;
+  mutable std::shared_mutex tileViewMutex;
+  // living characters and their simulation state
+  CharacterStore characters;
+  // handle of every character ever added, by instance ID
+  std::vector<CharacterHandle> characterHandles;
+  // rows of the characters that died this tick
+  std::vector<size_t> deadRows;
+  // decide phase buffers, kept across ticks so enumeration does not allocate
+  std::vector<Character*> deciders;
+  std::vector<DecisionBatch*> deciderBatches;
+  std::vector<std::vector<ActionDesc>> availableActions;
+  std::vector<size_t> actionChoices;
+  // the deciders of one decision batch and what it chose for them
+  struct BatchGroup {
+    DecisionBatch* batch;
+    std::vector<size_t> rows;
+    std::vector<AbstractActor*> actors;
+    std::vector<const std::vector<ActionDesc>*> actions;
+    std::vector<size_t> choices;
+  };
+  // slot of every batch this tick, slots numbered in order of first decider
+  std::unordered_map<DecisionBatch*, size_t> batchSlots;
+  std::vector<BatchGroup> batchGroups;
+  // tile ID of every character and character IDs on every tile
+  OccupancyIndex occupancy;
+  // characters and tile caps by bucket, for neighbourhood queries
+  SpatialIndex spatialIndex;
+
+  const size_t randomSeed;
 
   size_t tileCount;
+  size_t characterCount;
+  size_t tick;
   std::vector<ResourceManagerRef> tile_prototypes;
   std::vector<double> weights;
 
-  const size_t randomSeed;
+  // actions chosen this tick, applied grouped by target
+  CommandBuffer commandBuffer;
+  ResolutionPolicyPtr resolutionPolicy;
+
+  std::shared_ptr<ThreadPool> threadPool;
+
+  // Observations are double buffered: tensors wrapped around a frame during a
+  // tick stay valid through the next tick, long enough for actors to
+  // backpropagate through them.
+  struct ObservationFrame {
+    std::vector<float> grid;
+    std::vector<float> tiles;
+    std::vector<float> characters;
+  };
+  bool observationsEnabled;
+  ObservationFrame observationFrames[2];
+  size_t currentObservation;
+  size_t observationStamp;
+  // tile rows rewritten by the last update and the stamp they changed from
+  std::vector<uint32_t> tileChanges;
+  size_t tileChangesSince;
+  std::vector<uint32_t> previousDirtyTiles;
+
+  std::unique_ptr<ResourceField> resourceField;
+
+  TilePtr getTileView(size_t tileID) const;
+  // forget views only the cache still holds
+  void pruneTileViews();
+
+  // the deciders with a decision batch, one call per batch, batches in parallel
+  void decideBatches();
+
+  void syncObservations();
+  // dirtyTiles nullptr rewrites every tile row
+  void writeObservations(ObservationFrame& frame, const std::vector<uint32_t>* dirtyTiles);
 };
 
 #endif // GRIDWORLD_HPP
\ No newline at end of file
@@ -7,9 +7,9 @@
 
 class HarvestAction : public AbstractAction {
 public:
-  static const size_t ActionID;
+  static constexpr size_t ActionID = 2;
 
-  static void execute(ElementBase* subject, ElementBase* object) {
+  static void execute(GridWorld& world, ElementBase* subject, ElementBase* object) {
     // require the subject to be a character
     Character* character = dynamic_cast<Character*>(subject);
     // require the object to be a tile
@@ -18,19 +18,47 @@ public:
     if (character && tile) {
       // harvest the tile
       character->addResources(tile->getResources());
-      tile->getResources().kcal = 0;
+      tile->setResources(Resources{0});
+    }
+  }
+
+  // every harvest of the tick, sorted by tile. Several characters harvesting
+  // one tile divide its resources by their shares.
+  static void executeBatch(GridWorld& world, const ActionDesc* actions, const double* shares, size_t count) {
+    size_t begin = 0;
+    while (begin < count) {
+      size_t end = begin + 1;
+      while (end < count && actions[end].ObjectClassID == actions[begin].ObjectClassID &&
+             actions[end].ObjectInstanceID == actions[begin].ObjectInstanceID) {
+        end++;
+      }
+      if (actions[begin].ObjectClassID == Tile::ElementID) {
+        harvest(*static_cast<Tile*>(actions[begin].object), actions + begin, shares + begin, end - begin);
+      }
+      begin = end;
     }
   }
 
 private:
+  static void harvest(Tile& tile, const ActionDesc* group, const double* shares, size_t count) {
+    const Resources available = tile.getResources();
+    double granted = 0;
+    for (size_t i = 0; i < count; i++) {
+      if (group[i].SubjectClassID == Character::ElementID && shares[i] > 0) {
+        static_cast<Character*>(group[i].subject)->addResources(available * shares[i]);
+        granted += shares[i];
+      }
+    }
+    tile.setResources(granted >= 1 ? Resources{0} : available * (1 - granted));
+  }
+
   // Register the action in the registry
   static bool registered;
 };
 
-inline const size_t HarvestAction::ActionID = 2;
-
 inline bool HarvestAction::registered = []() {
   HarvestAction::registerAction(HarvestAction::ActionID, HarvestAction::execute);
+  HarvestAction::registerBatchAction(HarvestAction::ActionID, HarvestAction::executeBatch);
   return true;
 }();
 
@@ -0,0 +1,105 @@
+#ifndef MAP_GENERATOR_HPP
+#define MAP_GENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "grid_topology.hpp"
+#include "thread_pool.hpp"
+#include "tile_store.hpp"
+
+// how prototypes are laid out over the map
+enum class MapLayout {
+  // every tile drawn independently with probability proportional to its weight
+  Uniform,
+  // biomes of coherent noise, each prototype covering its share of the map
+  Noise
+};
+
+// Picks the prototype of every tile. The map is filled in square chunks of
+// ChunkSize tiles a side, and a chunk only depends on the seed and its
+// position, so chunks can run on any number of threads and give the same map.
+//
+// The noise layout sums octaves of value noise: random values on a lattice
+// with a cell every noiseScale tiles, each further octave twice as fine at
+// half the amplitude, smoothly interpolated in between. The weights cut the
+// range of the noise into one band per prototype, at quantiles estimated
+// from a fixed sample of the map, so every prototype still covers about its
+// weight of the tiles, and prototypes next to each other in the list border
+// each other on the map. On a torus the lattice wraps without a seam.
+class MapGenerator {
+public:
+  static constexpr size_t ChunkSize = 64;
+
+  // weights need not be normalised
+  MapGenerator(const GridTopology& topology,
+               size_t seed,
+               const std::vector<double>& weights,
+               MapLayout layout,
+               double noiseScale,
+               size_t noiseOctaves);
+
+  // prototype index of every tile by tile ID, on pool when not nullptr
+  std::vector<TileStore::PrototypeIndex> generate(ThreadPool* pool);
+
+private:
+  // random values at the lattice points of one octave, column by column
+  struct Octave {
+    size_t columns;
+    size_t rows;
+    // lattice cells per tile
+    double xScale;
+    double yScale;
+    double amplitude;
+    std::vector<float> values;
+  };
+
+  // lattice rows around a tile row and the weight between them
+  struct RowTerm {
+    uint32_t first;
+    uint32_t second;
+    double weight;
+  };
+
+  void buildOctaves(ThreadPool* pool);
+
+  // band bounds in noise values from a sample of the map
+  void fitBands();
+
+  // row terms of every octave for y in [begin, end), octave by octave
+  void rowTerms(size_t begin, size_t end, RowTerm* out) const;
+
+  // noise at span tiles of column x, given their row terms
+  void noiseColumn(size_t x, size_t span, const RowTerm* rows, double* out) const;
+
+  void fillChunk(size_t chunk, std::vector<TileStore::PrototypeIndex>& out) const;
+
+  // a table of the band at evenly spaced values, so picks rarely search
+  void buildGuide();
+
+  // first prototype whose band ends above value
+  TileStore::PrototypeIndex pick(double value) const;
+
+  const GridTopology& topology;
+  const size_t seed;
+  const MapLayout layout;
+  const double noiseScale;
+  const size_t noiseOctaves;
+  const size_t chunkRows;
+  // upper end of every prototype's share of the cumulative weights, the last is 1
+  std::vector<double> shares;
+  // upper end of every prototype's band of values, the draws or the noise
+  std::vector<double> bands;
+  std::vector<Octave> octaves;
+  std::vector<TileStore::PrototypeIndex> guide;
+  double guideLow = 0.0;
+  // guide slots per unit of value
+  double guideScale = 0.0;
+};
+
+// "uniform" or "noise"
+MapLayout parseMapLayout(const std::string& name);
+
+#endif // MAP_GENERATOR_HPP
@@ -8,38 +8,47 @@
 
 class MoveAction : public AbstractAction {
 public:
-  static const size_t ActionID;
+  static constexpr size_t ActionID = 1;
 
-  // move the subject to the object
-  static void execute(ElementBase* subject, ElementBase* object) {
+  // move the subject to the object, the object has to be adjacent to where the subject stands
+  static void execute(GridWorld& world, ElementBase* subject, ElementBase* object) {
     // require the subject to be a character
     Character* character = dynamic_cast<Character*>(subject);
     // require the object to be a tile
     Tile* newTile = dynamic_cast<Tile*>(object);
 
     if (character && newTile) {
-      constTilePtr oldTile = character->getPosition();
-      GridWorld& world = GridWorld::getInstance();
-      size_t newTileID = newTile->getInstanceID();
-      size_t oldTileID = oldTile->getInstanceID();
-      if (newTileID != oldTileID) {
-        double burnRate = character->getTraits().kcal_burn_rate;
-        TilePtr newTilePtr = world.getTile(newTileID);
-        character->burnKcal(2*burnRate);
-        character->setPosition(newTilePtr);
+      move(world, *character, newTile->getInstanceID());
+    }
+  }
+
+  // every move of the tick, subjects and objects are known to be characters and tiles
+  static void executeBatch(GridWorld& world, const ActionDesc* actions, const double* shares, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      const ActionDesc& action = actions[i];
+      if (action.SubjectClassID == Character::ElementID && action.ObjectClassID == Tile::ElementID) {
+        move(world, *static_cast<Character*>(action.subject), action.ObjectInstanceID);
       }
     }
   }
 
 private:
+  static void move(GridWorld& world, Character& character, size_t newTileID) {
+    size_t oldTileID = character.getPosition()->getInstanceID();
+    if (newTileID != oldTileID && world.getTopology().isAdjacent(oldTileID, newTileID)) {
+      double burnRate = character.getTraits().kcal_burn_rate;
+      character.burnKcal(2*burnRate);
+      character.setPosition(world.getTile(newTileID));
+    }
+  }
+
   // Register the action in the registry
   static bool registered;
 };
 
-inline const size_t MoveAction::ActionID = 1;
-
 inline bool MoveAction::registered = []() {
   MoveAction::registerAction(MoveAction::ActionID, MoveAction::execute);
+  MoveAction::registerBatchAction(MoveAction::ActionID, MoveAction::executeBatch);
   return true;
 }();
 
@@ -0,0 +1,111 @@
+#ifndef OCCUPANCY_INDEX_HPP
+#define OCCUPANCY_INDEX_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Which characters stand on which tile, as intrusive doubly linked lists
+// threaded through flat arrays. Tiles and characters are addressed by their
+// (dense, per world) instance IDs. Lookups in both directions and moves are
+// O(1), walking the occupants of a tile is O(occupants).
+class OccupancyIndex {
+public:
+  static constexpr size_t None = std::numeric_limits<uint32_t>::max();
+
+  void resize(size_t tileCount) {
+    head.assign(tileCount, None);
+    counts.assign(tileCount, 0);
+  }
+
+  void insert(size_t characterID, size_t tileID) {
+    if (characterID >= tileOf.size()) {
+      tileOf.resize(characterID + 1, None);
+      prev.resize(characterID + 1, None);
+      next.resize(characterID + 1, None);
+    }
+    link(characterID, tileID);
+  }
+
+  void move(size_t characterID, size_t tileID) {
+    if (tileOf[characterID] == tileID) {
+      return;
+    }
+    unlink(characterID);
+    link(characterID, tileID);
+  }
+
+  void remove(size_t characterID) {
+    if (contains(characterID)) {
+      unlink(characterID);
+      tileOf[characterID] = None;
+    }
+  }
+
+  bool contains(size_t characterID) const {
+    return characterID < tileOf.size() && tileOf[characterID] != None;
+  }
+
+  // tile the character stands on, None if it is not in the index
+  size_t getTile(size_t characterID) const {
+    return characterID < tileOf.size() ? tileOf[characterID] : None;
+  }
+
+  // number of characters on the tile
+  size_t count(size_t tileID) const {
+    return counts[tileID];
+  }
+
+  // first character on the tile, None if the tile is empty
+  size_t first(size_t tileID) const {
+    return head[tileID];
+  }
+
+  // the character after characterID on the same tile, None at the end
+  size_t nextOnTile(size_t characterID) const {
+    return next[characterID];
+  }
+
+  template <typename Function>
+  void forEachOnTile(size_t tileID, Function f) const {
+    for (size_t characterID = head[tileID]; characterID != None; characterID = next[characterID]) {
+      f(characterID);
+    }
+  }
+
+private:
+  void link(size_t characterID, size_t tileID) {
+    tileOf[characterID] = static_cast<uint32_t>(tileID);
+    prev[characterID] = None;
+    next[characterID] = head[tileID];
+    if (head[tileID] != None) {
+      prev[head[tileID]] = static_cast<uint32_t>(characterID);
+    }
+    head[tileID] = static_cast<uint32_t>(characterID);
+    counts[tileID]++;
+  }
+
+  void unlink(size_t characterID) {
+    size_t tileID = tileOf[characterID];
+    if (prev[characterID] != None) {
+      next[prev[characterID]] = next[characterID];
+    } else {
+      head[tileID] = next[characterID];
+    }
+    if (next[characterID] != None) {
+      prev[next[characterID]] = prev[characterID];
+    }
+    counts[tileID]--;
+  }
+
+  // per tile
+  std::vector<uint32_t> head;
+  std::vector<uint32_t> counts;
+  // per character
+  std::vector<uint32_t> tileOf;
+  std::vector<uint32_t> prev;
+  std::vector<uint32_t> next;
+};
+
+#endif // OCCUPANCY_INDEX_HPP
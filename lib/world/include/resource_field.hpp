@@ -0,0 +1,68 @@
+#ifndef RESOURCE_FIELD_HPP
+#define RESOURCE_FIELD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "grid_topology.hpp"
+#include "tile_store.hpp"
+
+// Distance in steps from every tile to the nearest tile holding at least a
+// threshold of kcal, for navigation. Harvests and regrowth only flip a few
+// tiles above or below the threshold per tick, so the field is repaired
+// around the tiles that changed instead of being rebuilt: tiles whose
+// distance led to a tile that dropped below the threshold are cleared and
+// refilled from their intact surroundings, tiles that rose above it spread
+// shorter distances outward.
+class ResourceField {
+public:
+  static constexpr uint32_t Unreachable = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t None = std::numeric_limits<size_t>::max();
+
+  ResourceField(const GridTopology& topology, double threshold);
+
+  double getThreshold() const {
+    return threshold;
+  }
+
+  // from scratch, one breadth first pass over the map
+  void build(const TileStore& store);
+
+  // re-examine the tiles in changed, which may repeat
+  void update(const TileStore& store, const std::vector<uint32_t>& changed);
+
+  // Unreachable when no tile is above the threshold
+  uint32_t getDistance(size_t tileID) const {
+    return distance[tileID];
+  }
+
+  bool isSource(size_t tileID) const {
+    return source[tileID] != 0;
+  }
+
+  // direction from tileID (GridTopology::getDirections) of a neighbour one
+  // step closer, None on a source or when nothing is reachable
+  size_t nextStep(size_t tileID) const;
+
+private:
+  typedef std::pair<uint32_t, uint32_t> Entry;
+
+  // spread distances from the queued entries, lowest first
+  void propagate();
+
+  const GridTopology& topology;
+  const double threshold;
+
+  // per tile
+  std::vector<uint32_t> distance;
+  std::vector<uint8_t> source;
+
+  // scratch, kept between updates
+  std::vector<uint32_t> cleared;
+  std::vector<Entry> frontier;
+  std::vector<Entry> queue;
+};
+
+#endif // RESOURCE_FIELD_HPP
@@ -0,0 +1,27 @@
+#ifndef ROLLOUT_ACTOR_HPP
+#define ROLLOUT_ACTOR_HPP
+
+#include "abstract_actor.hpp"
+#include "gridworld.hpp"
+
+// Plans by simulation: every offered action is tried in RolloutActor.rollouts
+// forks of the world, each continued RolloutActor.depth steps with random
+// valid actions, and the action with the highest mean reward is taken.
+class RolloutActor : public AbstractActor {
+public:
+  RolloutActor(const GridWorld& world, size_t charID);
+  virtual ~RolloutActor();
+
+  virtual size_t selectAction(const std::vector<ActionDesc>& actions) override;
+  virtual void update(double reward) override;
+
+private:
+  const size_t characterID;
+  const GridWorld& world;
+  const size_t rollouts;
+  const size_t depth;
+  // hours per simulated step, the same as the simulation's
+  const double frameTime;
+};
+
+#endif // ROLLOUT_ACTOR_HPP
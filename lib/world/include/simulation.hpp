@@ -0,0 +1,45 @@
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include <cstddef>
+#include <vector>
+#include <functional>
+
+class GridWorld;
+
+// Advances one or more worlds one fixed step at a time, independent of any
+// display. The GUI controller paces calls to step() against a wall clock, the
+// headless runner calls it back to back.
+class Simulation {
+public:
+  // frameTime is the number of simulated hours per step
+  Simulation(double frameTime = 1.0);
+
+  // worlds are stepped in the order they were added
+  void addWorld(GridWorld& world);
+
+  // advance every world by one step, returns false once nothing is left alive
+  bool step();
+
+  double getTimeElapsed() const {
+    return timeAccumulator;
+  }
+
+  size_t getTickCount() const {
+    return tickCount;
+  }
+
+  // continue the clock of a run restored from a checkpoint
+  void resume(double timeElapsed, size_t tickCount) {
+    timeAccumulator = timeElapsed;
+    this->tickCount = tickCount;
+  }
+
+private:
+  const double frameTime;
+  double timeAccumulator = 0.0;
+  size_t tickCount = 0;
+  std::vector<std::reference_wrapper<GridWorld>> worlds;
+};
+
+#endif // SIMULATION_HPP
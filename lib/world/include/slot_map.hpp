@@ -0,0 +1,158 @@
+#ifndef SLOT_MAP_HPP
+#define SLOT_MAP_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Refers to a value in a SlotMap. A handle goes stale when its value is
+// erased, even if the slot is reused later, because the generation no
+// longer matches.
+struct SlotHandle {
+  uint32_t index;
+  uint32_t generation;
+
+  bool operator==(const SlotHandle& other) const {
+    return index == other.index && generation == other.generation;
+  }
+
+  bool operator!=(const SlotHandle& other) const {
+    return !(*this == other);
+  }
+};
+
+// Values packed densely in one vector, addressed through generational
+// handles. Lookups by handle are two array reads, erasing swaps the last
+// value into the hole, and iteration is a linear scan. The dense order is
+// deterministic but changes whenever a value is erased.
+template <class T>
+class SlotMap {
+public:
+  static constexpr uint32_t None = std::numeric_limits<uint32_t>::max();
+
+  typedef typename std::vector<T>::iterator iterator;
+  typedef typename std::vector<T>::const_iterator const_iterator;
+
+  SlotHandle insert(T value) {
+    uint32_t index;
+    if (freeHead != None) {
+      index = freeHead;
+      freeHead = slots[index].dense;
+    } else {
+      index = static_cast<uint32_t>(slots.size());
+      slots.push_back(Slot{None, 0});
+    }
+    slots[index].dense = static_cast<uint32_t>(values.size());
+    values.push_back(std::move(value));
+    slotOf.push_back(index);
+    return SlotHandle{index, slots[index].generation};
+  }
+
+  // swap-removes the value, returns false if the handle was stale
+  bool erase(SlotHandle handle) {
+    if (!contains(handle)) {
+      return false;
+    }
+    eraseAt(slots[handle.index].dense);
+    return true;
+  }
+
+  // swap-removes the value at a dense position
+  void eraseAt(size_t denseIndex) {
+    uint32_t index = slotOf[denseIndex];
+    if (denseIndex + 1 != values.size()) {
+      values[denseIndex] = std::move(values.back());
+      slotOf[denseIndex] = slotOf.back();
+      slots[slotOf[denseIndex]].dense = static_cast<uint32_t>(denseIndex);
+    }
+    values.pop_back();
+    slotOf.pop_back();
+    slots[index].generation++;
+    slots[index].dense = freeHead;
+    freeHead = index;
+  }
+
+  bool contains(SlotHandle handle) const {
+    return handle.index < slots.size() && slots[handle.index].generation == handle.generation
+           && slots[handle.index].dense < values.size() && slotOf[slots[handle.index].dense] == handle.index;
+  }
+
+  // nullptr for stale handles
+  T* get(SlotHandle handle) {
+    return contains(handle) ? &values[slots[handle.index].dense] : nullptr;
+  }
+
+  const T* get(SlotHandle handle) const {
+    return contains(handle) ? &values[slots[handle.index].dense] : nullptr;
+  }
+
+  // position of a live value in the dense order
+  size_t denseIndexOf(SlotHandle handle) const {
+    return slots[handle.index].dense;
+  }
+
+  SlotHandle handleAt(size_t denseIndex) const {
+    uint32_t index = slotOf[denseIndex];
+    return SlotHandle{index, slots[index].generation};
+  }
+
+  T& operator[](size_t denseIndex) {
+    return values[denseIndex];
+  }
+
+  const T& operator[](size_t denseIndex) const {
+    return values[denseIndex];
+  }
+
+  size_t size() const {
+    return values.size();
+  }
+
+  bool empty() const {
+    return values.empty();
+  }
+
+  void reserve(size_t count) {
+    values.reserve(count);
+    slotOf.reserve(count);
+    slots.reserve(count);
+  }
+
+  void clear() {
+    while (!values.empty()) {
+      eraseAt(values.size() - 1);
+    }
+  }
+
+  iterator begin() {
+    return values.begin();
+  }
+
+  iterator end() {
+    return values.end();
+  }
+
+  const_iterator begin() const {
+    return values.begin();
+  }
+
+  const_iterator end() const {
+    return values.end();
+  }
+
+private:
+  struct Slot {
+    // position in values while live, next free slot while free
+    uint32_t dense;
+    uint32_t generation;
+  };
+
+  std::vector<Slot> slots;
+  std::vector<T> values;
+  // slot of every dense value
+  std::vector<uint32_t> slotOf;
+  uint32_t freeHead = None;
+};
+
+#endif // SLOT_MAP_HPP
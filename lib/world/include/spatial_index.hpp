@@ -0,0 +1,90 @@
+#ifndef SPATIAL_INDEX_HPP
+#define SPATIAL_INDEX_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "grid_topology.hpp"
+#include "occupancy_index.hpp"
+#include "tile_store.hpp"
+
+// Neighbourhood queries over characters and tiles. The map is cut into
+// square buckets of BucketSize tiles a side; characters are kept in
+// intrusive lists per bucket (an OccupancyIndex over buckets, so moves are
+// O(1)), and every bucket knows the highest cap of its tiles. A query only
+// visits the buckets overlapping its square and skips buckets without
+// characters, or without tiles that can reach the requested kcal, so its
+// cost does not grow with the population or the map.
+//
+// Distances are steps between adjacent tiles as given by the topology. The
+// index reads the world's topology, tile store and occupancy; queries may
+// run from any number of threads between updates.
+class SpatialIndex {
+public:
+  static constexpr size_t BucketSize = 16;
+
+  SpatialIndex(const GridTopology& topology, const TileStore& tiles, const OccupancyIndex& occupancy);
+
+  // forget every character
+  void clear();
+
+  // recompute the bucket caps once the tiles of the map are in the store
+  void indexTiles();
+
+  void insert(size_t characterID, size_t tileID) {
+    characters.insert(characterID, bucketOf(tileID));
+  }
+
+  void move(size_t characterID, size_t tileID) {
+    characters.move(characterID, bucketOf(tileID));
+  }
+
+  void remove(size_t characterID) {
+    characters.remove(characterID);
+  }
+
+  // characters at most radius steps from tileID, appended to out
+  void findCharacters(size_t tileID, size_t radius, std::vector<size_t>& out) const;
+
+  // the k characters closest to tileID, nearest first, ties by ID
+  void findNearestCharacters(size_t tileID, size_t k, std::vector<size_t>& out) const;
+
+  // tiles at most radius steps from tileID with at least minKcal, appended to out
+  void findTiles(size_t tileID, size_t radius, double minKcal, std::vector<size_t>& out) const;
+
+  // the k tiles closest to tileID with at least minKcal, nearest first, ties by ID
+  void findNearestTiles(size_t tileID, size_t k, double minKcal, std::vector<size_t>& out) const;
+
+private:
+  size_t bucketOf(size_t tileID) const {
+    return (tileID / height / BucketSize) * bucketRows + (tileID % height) / BucketSize;
+  }
+
+  // buckets overlapping the square of tiles within radius of tileID
+  template <class F>
+  void forEachBucket(size_t tileID, size_t radius, F&& f) const;
+
+  // 1D: the bucket indices covering [centre - radius, centre + radius]
+  void bucketSpan(size_t centre, size_t radius, size_t extent, std::vector<size_t>& out) const;
+
+  // grow the radius until the k nearest are known, find holds the query
+  // tile and gives the candidates within a radius and their distance to it
+  template <class Find>
+  void findNearest(size_t k, std::vector<size_t>& out, Find&& find) const;
+
+  const GridTopology& topology;
+  const TileStore& tiles;
+  const OccupancyIndex& occupancy;
+  const size_t width;
+  const size_t height;
+  const size_t bucketColumns;
+  const size_t bucketRows;
+
+  // characters by bucket
+  OccupancyIndex characters;
+  // highest cap of the tiles in every bucket
+  std::vector<double> bucketCap;
+};
+
+#endif // SPATIAL_INDEX_HPP
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include "element.hpp"
+#include "grid_topology.hpp"
 
 struct Resources {
   double kcal;
@@ -52,16 +53,11 @@ struct ResourceManager {
 
   ResourceManager(Resources resources, Resources resourcesPerHour, Resources maxResources)
     : resources(resources), resourcesPerHour(resourcesPerHour), maxResources(maxResources) {};
-
-  void update(double elapsedTime) {
-    resources += resourcesPerHour * elapsedTime;
-    if (resources.kcal > maxResources.kcal) {
-      resources = maxResources;
-    }
-  }
 };
 
 class Tile;
+class TileStore;
+class GridWorld;
 
 typedef std::shared_ptr<Tile> TilePtr;
 typedef std::shared_ptr<const Tile> constTilePtr;
@@ -71,51 +67,50 @@ class Tile : public Element<Tile> {
   friend class Element<Tile>;
 public:
   static const size_t ElementID = 1;
-  static const size_t FeatureSize = 9;
-
-  Tile(ResourceManager resources)
-    : Element<Tile>(), resources(resources) {}
+  // element ID, instance ID, one slot per possible neighbour (-1 where the
+  // topology has fewer), kcal, kcal per hour, max kcal
+  static const size_t FeatureSize = 5 + GridTopology::MaxNeighbours;
+  static const size_t ResourcesFeature = 2 + GridTopology::MaxNeighbours;
+
+  // Flyweight view onto one cell of a world. The state of a tile lives in the
+  // world's TileStore and its neighbours follow from its coordinates, so views
+  // are only created for tiles something currently refers to.
+  Tile(size_t instanceID, GridWorld& world, TileStore& store, size_t index)
+    : Element<Tile>(instanceID), world(world), store(store), index(index) {}
   ~Tile() = default;
 
-  std::unique_ptr<double[]> getFeatures() const override {
-    std::unique_ptr<double[]> features(new double[FeatureSize]);
-    features[0] = ElementID;
-    features[1] = getInstanceID();
-    features[2] = adjacentTiles[0] ? adjacentTiles[0]->getInstanceID() : -1;
-    features[3] = adjacentTiles[1] ? adjacentTiles[1]->getInstanceID() : -1;
-    features[4] = adjacentTiles[2] ? adjacentTiles[2]->getInstanceID() : -1;
-    features[5] = adjacentTiles[3] ? adjacentTiles[3]->getInstanceID() : -1;
-    features[6] = resources.resources.kcal;
-    features[7] = resources.resourcesPerHour.kcal;
-    features[8] = resources.maxResources.kcal;
-    return features;
-  }
+  std::unique_ptr<double[]> getFeatures() const override;
 
-  void addAdjacentTile(const TilePtr& tile) {
-    adjacentTiles.push_back(tile);
-  }
+  // same layout as getFeatures, written into FeatureSize floats
+  void writeFeatures(float* features) const;
 
-  const std::vector<TilePtr>& getAdjacentTiles() const {
-    return adjacentTiles;
-  }
+  // the same for any tile of world, without creating a view
+  static void writeFeatures(const GridWorld& world, size_t tileID, float* features);
 
-  ResourceManager& getResourceManager() {
-    return resources;
-  }
+  std::vector<TilePtr> getAdjacentTiles() const;
 
-  Resources& getResources() {
-    return resources.resources;
+  GridWorld& getWorld() const {
+    return world;
   }
 
-  const Resources& getResources() const {
-    return resources.resources;
+  size_t getStoreIndex() const {
+    return index;
   }
 
+  Resources getResources() const;
+
+  void setResources(const Resources& resources);
+
+  Resources getResourcesPerHour() const;
+
+  Resources getMaxResources() const;
+
   void update(double elapsedTime) override;
 
 private:
-  std::vector<TilePtr> adjacentTiles;
-  ResourceManager resources;
+  GridWorld& world;
+  TileStore& store;
+  const size_t index;
 };
 
 #endif // TILE_HPP
\ No newline at end of file
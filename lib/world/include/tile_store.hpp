@@ -0,0 +1,197 @@
+#ifndef TILE_STORE_HPP
+#define TILE_STORE_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "tile.hpp"
+
+// Compact storage for the resource state of every tile in a map. A tile is a
+// prototype index and its current kcal; regeneration rate and cap are
+// constant per prototype and live once in a shared table. Tiles below their
+// cap are tracked in an active set, the only tiles regeneration changes.
+//
+// In lazy mode the store keeps a clock instead of stepping tiles: an active
+// tile holds its resources as of its last write, and reads evaluate the
+// linear regrowth since then in closed form. When a tile will reach its cap
+// is known at its last write, so those times are kept in a min-heap and
+// regeneration only advances the clock and visits the tiles whose time came.
+// Active tiles are not marked dirty as they regrow, only when written, when
+// they reach their cap or when they grow past the watch level.
+class TileStore {
+  friend class WorldSnapshot;
+public:
+  typedef uint16_t PrototypeIndex;
+  static constexpr uint32_t None = UINT32_MAX;
+
+  // switching modes brings every tile up to date first
+  void setLazy(bool lazy);
+
+  bool isLazy() const {
+    return lazy;
+  }
+
+  // lazily regrowing tiles are also marked dirty when they grow past level,
+  // for readers that only care which side of it a tile is on
+  void setWatchLevel(double level);
+
+  void reserve(size_t count);
+
+  void clear();
+
+  // add a prototype to the shared table, returns its index
+  PrototypeIndex addPrototype(const ResourceManager& prototype);
+
+  size_t getPrototypeCount() const {
+    return prototypeRate.size();
+  }
+
+  // append a tile initialised from a prototype, returns its index in the store
+  size_t addTile(PrototypeIndex prototype);
+
+  // replace every tile with tiles initialised from prototypes, by index
+  void assignTiles(std::vector<PrototypeIndex>&& prototypes);
+
+  size_t size() const {
+    return resources.size();
+  }
+
+  PrototypeIndex getPrototype(size_t index) const {
+    return prototypeOf[index];
+  }
+
+  Resources getResources(size_t index) const {
+    return Resources{currentResources(index)};
+  }
+
+  void setResources(size_t index, const Resources& value) {
+    resources[index] = static_cast<float>(value.kcal);
+    if (activeSlot[index] != None) {
+      activeSince[activeSlot[index]] = clock;
+    }
+    touch(index);
+  }
+
+  Resources getResourcesPerHour(size_t index) const {
+    return Resources{prototypeRate[prototypeOf[index]]};
+  }
+
+  Resources getMaxResources(size_t index) const {
+    return Resources{prototypeCap[prototypeOf[index]]};
+  }
+
+  // regenerate a single tile, clamped to its maximum
+  void regenerate(size_t index, double elapsedTime);
+
+  // regenerate every tile, clamped to its maximum
+  void regenerate(double elapsedTime);
+
+  // hours regenerated since the store was filled
+  double getClock() const {
+    return clock;
+  }
+
+  // indices whose resources changed since the last clearDirty, may repeat
+  const std::vector<uint32_t>& getDirtyTiles() const {
+    return dirty;
+  }
+
+  void clearDirty() {
+    dirty.clear();
+  }
+
+  // indices of the tiles below their cap, in lazy mode their resources
+  // change every tick without being marked dirty
+  const std::vector<uint32_t>& getActiveTiles() const {
+    return active;
+  }
+
+private:
+  double currentResources(size_t index) const {
+    uint32_t slot = activeSlot[index];
+    if (!lazy || slot == None) {
+      return resources[index];
+    }
+    PrototypeIndex prototype = prototypeOf[index];
+    double regrown = resources[index] + prototypeRate[prototype] * (clock - activeSince[slot]);
+    return regrown < prototypeCap[prototype] ? regrown : prototypeCap[prototype];
+  }
+
+  // fold the regrowth since the last write into the stored value
+  void materialize(size_t index) {
+    resources[index] = static_cast<float>(currentResources(index));
+    if (activeSlot[index] != None) {
+      activeSince[activeSlot[index]] = clock;
+    }
+  }
+
+  // record a change and start tracking the tile while it is below its cap
+  void touch(size_t index) {
+    dirty.push_back(static_cast<uint32_t>(index));
+    if (activeSlot[index] == None) {
+      activate(index);
+    } else {
+      schedule(index);
+    }
+  }
+
+  void activate(size_t index) {
+    if (activeSlot[index] == None && resources[index] < prototypeCap[prototypeOf[index]]) {
+      activeSlot[index] = static_cast<uint32_t>(active.size());
+      active.push_back(static_cast<uint32_t>(index));
+      activeSince.push_back(clock);
+      schedule(index);
+    }
+  }
+
+  // stop tracking the tile at active[slot], it is at its cap
+  void retire(size_t slot);
+
+  // clock at which an active tile next needs a visit in lazy mode, when it
+  // grows past the watch level or reaches its cap
+  double nextEvent(size_t index) const;
+
+  // queue the next event of an active tile, lazy mode only
+  void schedule(size_t index);
+
+  // the events of every active tile, dropping outdated ones
+  void rebuildSchedule();
+
+  // per tile, 10 bytes in total
+  std::vector<float> resources;
+  std::vector<PrototypeIndex> prototypeOf;
+  std::vector<uint32_t> activeSlot;
+
+  // per prototype
+  std::vector<double> prototypeInitial;
+  std::vector<double> prototypeRate;
+  std::vector<double> prototypeCap;
+
+  // per active tile, the clock at its last write is only read in lazy mode
+  std::vector<uint32_t> active;
+  std::vector<double> activeSince;
+
+  std::vector<uint32_t> dirty;
+
+  // min-heap of lazy mode events, an event is outdated once nextEvent of its
+  // tile no longer gives its time
+  struct Event {
+    double time;
+    uint32_t index;
+  };
+  std::vector<Event> events;
+  // heap order, the earliest event on top
+  static bool later(const Event& a, const Event& b) {
+    return a.time > b.time;
+  }
+  // tiles visited by the last regeneration, scheduled once it is done
+  std::vector<uint32_t> visited;
+
+  bool lazy = false;
+  double clock = 0.0;
+  double watchLevel = std::numeric_limits<double>::infinity();
+};
+
+#endif // TILE_STORE_HPP
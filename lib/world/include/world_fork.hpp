@@ -0,0 +1,106 @@
+#ifndef WORLD_FORK_HPP
+#define WORLD_FORK_HPP
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "action_space.hpp"
+#include "character.hpp"
+#include "tile.hpp"
+
+class GridWorld;
+
+// A what-if continuation of a GridWorld for lookahead. The fork simulates a
+// few characters of the world under the same rules as GridWorld::update;
+// everyone else stands still. Tile resources read through to the world
+// until the fork writes them, pages of PageSize tiles are copied on their
+// first write. Forking a fork shares all of its pages, so a child costs
+// nothing until it diverges, and dropping a fork frees only pages no other
+// fork refers to.
+//
+// A fork only reads the world, forks can be used from any number of threads
+// as long as the world does not change meanwhile.
+class WorldFork {
+public:
+  static constexpr size_t PageSize = 256;
+
+  // simulates the given living characters of the world as it is now
+  WorldFork(const GridWorld& world, const std::vector<size_t>& characterIDs);
+
+  // a child continuing from the current state of this fork
+  WorldFork fork() const {
+    return *this;
+  }
+
+  // hours simulated since the world was forked
+  double getClock() const {
+    return clock;
+  }
+
+  // ticks of the world plus the updates of the fork
+  size_t getTick() const {
+    return tick;
+  }
+
+  Resources getResources(size_t tileID) const;
+
+  // false for characters that died in the fork and for those it does not simulate
+  bool isAlive(size_t characterID) const;
+
+  // the state of simulated characters, throws std::out_of_range for others
+  size_t getPosition(size_t characterID) const;
+
+  CharacterTraits getTraits(size_t characterID) const;
+
+  double getReward(size_t characterID) const;
+
+  ActionMask getActionMask(size_t characterID) const;
+
+  // take the action behind slot of the character's action space in the next
+  // update, the action of a dead character is ignored
+  void act(size_t characterID, size_t slot);
+
+  // Apply the queued actions in the order they were queued, then metabolism
+  // and regeneration. A harvest takes everything on the tile, later harvests
+  // of the same tile in one update get what regrew since, that is nothing.
+  void update(double elapsedTime);
+
+private:
+  struct CharacterState {
+    size_t id;
+    size_t tileID;
+    double health;
+    double healthRegenRate;
+    double maxHealth;
+    double kcalOnHand;
+    double kcalBurnRate;
+    double reward;
+    bool alive;
+  };
+
+  // resources of PageSize tiles as of the clock they were last written at
+  struct TilePage {
+    std::array<float, PageSize> resources;
+    std::array<double, PageSize> since;
+  };
+
+  const CharacterState& state(size_t characterID) const;
+  CharacterState& state(size_t characterID);
+
+  // the page holding tileID, copied first if another fork shares it
+  TilePage& writablePage(size_t tileID);
+
+  const GridWorld* world;
+  double clock;
+  size_t tick;
+  std::vector<CharacterState> characters;
+  // page index and page, pages shared between forks are never written
+  std::vector<std::pair<size_t, std::shared_ptr<TilePage>>> pages;
+  // (character, slot) to take in the next update
+  std::vector<std::pair<size_t, size_t>> queued;
+};
+
+#endif // WORLD_FORK_HPP
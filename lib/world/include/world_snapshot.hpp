@@ -0,0 +1,72 @@
+#ifndef WORLD_SNAPSHOT_HPP
+#define WORLD_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "abstract_actor.hpp"
+
+class GridWorld;
+
+// creates the action policy of a restored character, nullptr leaves it without one
+typedef std::function<ActorPtr(GridWorld& world, size_t characterID)> ActorFactory;
+
+// A versioned binary checkpoint of one GridWorld: tile prototypes and
+// resources, the living characters with their state and position, the tick
+// and the simulated time. Random numbers come from streams keyed by seed and
+// tick, so those two are all the RNG state the world has. Actors add their
+// own state (counters, model weights) through AbstractActor::save and load.
+//
+// The file is a fixed header followed by 8 byte aligned arrays in the layout
+// of the stores. Opening a snapshot maps it read only and restoring copies
+// the arrays straight into the world without parsing them.
+class WorldSnapshot {
+public:
+  static constexpr uint32_t Version = 1;
+
+  // Writes to path + ".tmp" and renames it, a crash while saving never
+  // leaves a partial snapshot at path. Throws std::runtime_error when the
+  // file cannot be written.
+  static void save(const GridWorld& world, double timeElapsed, const std::string& path);
+
+  // throws std::runtime_error if the file cannot be mapped and
+  // std::invalid_argument if it is not a snapshot of this version
+  explicit WorldSnapshot(const std::string& path);
+  ~WorldSnapshot();
+
+  WorldSnapshot(const WorldSnapshot&) = delete;
+  WorldSnapshot& operator=(const WorldSnapshot&) = delete;
+
+  size_t getWidth() const;
+
+  size_t getHeight() const;
+
+  size_t getRandomSeed() const;
+
+  size_t getTick() const;
+
+  // simulated hours when the snapshot was taken
+  double getTimeElapsed() const;
+
+  // Replace the tiles, characters and tick of world with the snapshot. The
+  // world must have the same size and topology, std::invalid_argument
+  // otherwise, as is a corrupt file. Restored characters get their actor
+  // from makeActor, which is then handed the saved actor state. The tile
+  // regeneration mode stays the world's, whichever mode saved the tiles.
+  void restore(GridWorld& world, const ActorFactory& makeActor) const;
+
+private:
+  struct Header;
+
+  const Header& header() const;
+
+  // bytes at offset, throws std::invalid_argument if they run past the end
+  const char* at(uint64_t offset, uint64_t bytes) const;
+
+  const char* data;
+  size_t size;
+};
+
+#endif // WORLD_SNAPSHOT_HPP
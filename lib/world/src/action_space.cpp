@@ -0,0 +1,57 @@
+#include "action_space.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include "character.hpp"
+#include "tile.hpp"
+#include "move_action.hpp"
+#include "harvest_action.hpp"
+
+static_assert(ActionSpace::Size <= sizeof(ActionMask) * 8, "ActionMask too small for the action space");
+
+ActionMask ActionSpace::getMask(const GridTopology& topology, size_t tileID) {
+  std::array<size_t, GridTopology::MaxNeighbours> directions;
+  size_t directionCount = topology.getDirections(tileID, directions);
+  ActionMask mask = static_cast<ActionMask>((1u << Stay) | (1u << Harvest));
+  for (size_t direction = 0; direction < directionCount; direction++) {
+    if (directions[direction] != GridTopology::NoNeighbour) {
+      mask |= static_cast<ActionMask>(1u << (FirstMove + direction));
+    }
+  }
+  return mask;
+}
+
+size_t ActionSpace::getActionID(size_t slot) {
+  return slot == Harvest ? HarvestAction::ActionID : MoveAction::ActionID;
+}
+
+size_t ActionSpace::getTarget(const GridTopology& topology, size_t tileID, size_t slot) {
+  if (slot < FirstMove || slot >= Harvest) {
+    return tileID;
+  }
+  std::array<size_t, GridTopology::MaxNeighbours> directions;
+  topology.getDirections(tileID, directions);
+  return directions[slot - FirstMove];
+}
+
+void ActionSpace::writeFeatures(const GridTopology& topology,
+                                size_t characterID,
+                                size_t tileID,
+                                float* features) {
+  std::array<size_t, GridTopology::MaxNeighbours> directions;
+  size_t directionCount = topology.getDirections(tileID, directions);
+  std::fill(features, features + FeatureSize, 0.0f);
+  for (size_t slot = 0; slot < Size; slot++) {
+    bool isMove = slot >= FirstMove && slot < Harvest;
+    if (isMove && (slot - FirstMove >= directionCount || directions[slot - FirstMove] == GridTopology::NoNeighbour)) {
+      continue;
+    }
+    float* row = features + slot * ActionDesc::actionSize;
+    row[0] = Character::ElementID;
+    row[1] = characterID;
+    row[2] = getActionID(slot);
+    row[3] = Tile::ElementID;
+    row[4] = isMove ? directions[slot - FirstMove] : tileID;
+  }
+}
@@ -1,9 +1,30 @@
 #include "character.hpp"
 #include "move_action.hpp"
 #include "harvest_action.hpp"
+#include "gridworld.hpp"
+#include "character_store.hpp"
+#include "action_space.hpp"
 
 #include "data_writer.hpp"
 
+#include <string>
+
+namespace {
+std::string dataLabel(const Character& character) {
+  constTilePtr position = character.getPosition();
+  size_t worldID = position ? position->getWorld().getInstanceID() : 0;
+  return Character::getDataLabel(worldID, character.getInstanceID());
+}
+}
+
+// Every world numbers its characters from 0 and all of them write to the one
+// DataWriter, so labels name the world. The first world keeps the plain
+// labels, single world runs and the plotting scripts read as before.
+std::string Character::getDataLabel(size_t worldID, size_t characterID) {
+  std::string name = "Character " + std::to_string(characterID);
+  return worldID == 0 ? name : "World " + std::to_string(worldID) + " " + name;
+}
+
 void Character::setActionPolicy(ActorPtr& actor_) {
   actor = std::move(actor_);
   isActionSet = true;
@@ -11,72 +32,131 @@ void Character::setActionPolicy(ActorPtr& actor_) {
 
 void Character::getAvailableActions(std::vector<ActionDesc>& actions) {
   actions.clear();
-  TilePtr tile = position.lock();
-  // stay in place action, do nothing
-  ActionDesc stayInPlaceAction = {ElementID, getInstanceID(), MoveAction::ActionID, tile->getElementID(), tile->getInstanceID(), this, tile.get()};
-  actions.push_back(stayInPlaceAction);
-
-  // move to adjacent tile actions
-  for (TilePtr adjacentTile : tile->getAdjacentTiles()) {
-    ActionDesc moveAction = {ElementID,
-                            getInstanceID(),
-                            MoveAction::ActionID,
-                            adjacentTile->getElementID(),
-                            adjacentTile->getInstanceID(), this,
-                            dynamic_cast<ElementBase*>(adjacentTile.get())};
-    actions.push_back(moveAction);
+  GridWorld& world = position->getWorld();
+  const GridTopology& topology = world.getTopology();
+  size_t tileID = position->getInstanceID();
+  std::array<size_t, GridTopology::MaxNeighbours> directions;
+  size_t directionCount = topology.getDirections(tileID, directions);
+  // stay in place, move to an adjacent tile or harvest, in slot order
+  for (size_t slot = 0; slot < ActionSpace::Size; slot++) {
+    bool isMove = slot >= ActionSpace::FirstMove && slot < ActionSpace::Harvest;
+    if (isMove && (slot - ActionSpace::FirstMove >= directionCount ||
+                   directions[slot - ActionSpace::FirstMove] == GridTopology::NoNeighbour)) {
+      continue;
+    }
+    // moves leave the object unset, looking up the target view would lock the
+    // world's tile views in the parallel decide phase; it is resolved from
+    // ObjectInstanceID when the action runs
+    size_t targetID = isMove ? directions[slot - ActionSpace::FirstMove] : tileID;
+    ElementBase* target = isMove ? nullptr : position.get();
+    actions.push_back(ActionDesc{ElementID, getInstanceID(), ActionSpace::getActionID(slot),
+                                 Tile::ElementID, targetID, this, target, slot});
   }
-
-  // harvest action
-  ActionDesc harvestAction = {ElementID, getInstanceID(), HarvestAction::ActionID, tile->getElementID(), tile->getInstanceID(), this, tile.get()};
-  actions.push_back(harvestAction);
 }
 
 void Character::update(double elapsedTime) {
-  burnKcal(traits.kcal_burn_rate * elapsedTime);
-  if (traits.kcal_on_hand > 0 && traits.health < traits.max_health) {
-    traits.health += traits.health_regen_rate * elapsedTime;
-    reward += traits.health_regen_rate * elapsedTime;
-    if (traits.health > traits.max_health) {
-      traits.health = traits.max_health;
-    }
-  }
+  CharacterTraits current = getTraits();
+  double currentReward = getReward();
+  CharacterStore::metabolize(current.health, current.kcal_on_hand, currentReward,
+                             current.health_regen_rate, current.max_health, current.kcal_burn_rate,
+                             elapsedTime);
+  setTraits(current);
+  setReward(currentReward);
+  writeMetabolismData(current.kcal_burn_rate * elapsedTime);
+}
 
-  std::string name = "Character " + std::to_string(getInstanceID());
+void Character::writeMetabolismData(double kcalBurned) const {
+  CharacterTraits current = getTraits();
+  std::string name = dataLabel(*this);
   data_management::DataWriter& writer = data_management::DataWriter::getInstance();
+  std::string bLab = name + " Kcal Burned";
   std::string hLab = name + " Health";
   std::string kLab = name + " Kcal";
-  writer.writeData<double>(hLab.c_str(), data_management::DataType::DOUBLE, traits.health);
-  writer.writeData<double>(kLab.c_str(), data_management::DataType::DOUBLE, traits.kcal_on_hand);
+  writer.writeData<double>(bLab.c_str(), data_management::DataType::DOUBLE, kcalBurned);
+  writer.writeData<double>(hLab.c_str(), data_management::DataType::DOUBLE, current.health);
+  writer.writeData<double>(kLab.c_str(), data_management::DataType::DOUBLE, current.kcal_on_hand);
+}
+
+void Character::updateActor() {
+  if (isActionSet) {
+    actor->update(getReward());
+  }
+  setReward(0);
+}
 
-  actor->update(reward);
-  reward = 0;
+bool Character::isStored() const {
+  return store && store->contains(handle);
+}
+
+CharacterTraits Character::getTraits() const {
+  return isStored() ? store->getTraits(store->rowOf(handle)) : traits;
+}
+
+void Character::setTraits(const CharacterTraits& traits) {
+  if (isStored()) {
+    store->setTraits(store->rowOf(handle), traits);
+  } else {
+    this->traits = traits;
+  }
+}
+
+const double Character::getReward() const {
+  return isStored() ? store->getReward(store->rowOf(handle)) : reward;
+}
+
+void Character::setReward(double reward) {
+  if (isStored()) {
+    store->setReward(store->rowOf(handle), reward);
+  } else {
+    this->reward = reward;
+  }
+}
+
+void Character::addResources(const Resources& resources) {
+  CharacterTraits current = getTraits();
+  current.kcal_on_hand += resources.kcal;
+  setTraits(current);
 }
 
 std::unique_ptr<double[]> Character::getFeatures() const {
   std::unique_ptr<double[]> features(new double[FeatureSize]);
   features[0] = ElementID;
   features[1] = getInstanceID();
+  CharacterTraits traits = getTraits();
   features[2] = traits.health;
   features[3] = traits.health_regen_rate;
   features[4] = traits.max_health;
   features[5] = traits.kcal_on_hand;
   features[6] = traits.kcal_burn_rate;
-  features[7] = position.lock()->getInstanceID();
+  features[7] = position->getInstanceID();
   return features;
 }
 
+void Character::writeFeatures(float* features) const {
+  features[0] = ElementID;
+  features[1] = getInstanceID();
+  CharacterTraits traits = getTraits();
+  features[2] = traits.health;
+  features[3] = traits.health_regen_rate;
+  features[4] = traits.max_health;
+  features[5] = traits.kcal_on_hand;
+  features[6] = traits.kcal_burn_rate;
+  features[7] = position->getInstanceID();
+}
+
 void Character::burnKcal(double kcal) {
   data_management::DataWriter& writer = data_management::DataWriter::getInstance();
-  std::string name = "Character " + std::to_string(getInstanceID());
+  std::string name = dataLabel(*this);
   std::string lab = name + " Kcal Burned";
   writer.writeData(lab.c_str(), data_management::DataType::DOUBLE, kcal);
-  if (traits.kcal_on_hand > kcal) {
-    traits.kcal_on_hand -= kcal;
+  CharacterTraits current = getTraits();
+  if (current.kcal_on_hand > kcal) {
+    current.kcal_on_hand -= kcal;
   } else {
-    double remaining = kcal - traits.kcal_on_hand;
-    traits.kcal_on_hand = 0;
-    traits.health -= remaining;
-    reward -= remaining;
+    double remaining = kcal - current.kcal_on_hand;
+    current.kcal_on_hand = 0;
+    current.health -= remaining;
+    setReward(getReward() - remaining);
   }
-}
\ No newline at end of file
+  setTraits(current);
+}
@@ -0,0 +1,115 @@
+#include "character_store.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace {
+template <class T>
+void swapRemove(std::vector<T>& values, size_t row) {
+  values[row] = values.back();
+  values.pop_back();
+}
+}
+
+CharacterStore::~CharacterStore() {
+  clear();
+}
+
+CharacterHandle CharacterStore::insert(CharacterPtr character) {
+  const CharacterTraits& traits = character->traits;
+  health.push_back(traits.health);
+  healthRegenRate.push_back(traits.health_regen_rate);
+  maxHealth.push_back(traits.max_health);
+  kcalOnHand.push_back(traits.kcal_on_hand);
+  kcalBurnRate.push_back(traits.kcal_burn_rate);
+  reward.push_back(character->reward);
+  Character* attached = character.get();
+  CharacterHandle handle = characters.insert(std::move(character));
+  attached->store = this;
+  attached->handle = handle;
+  return handle;
+}
+
+void CharacterStore::eraseAt(size_t row) {
+  Character& character = *characters[row];
+  character.traits = getTraits(row);
+  character.reward = reward[row];
+  character.store = nullptr;
+
+  swapRemove(health, row);
+  swapRemove(healthRegenRate, row);
+  swapRemove(maxHealth, row);
+  swapRemove(kcalOnHand, row);
+  swapRemove(kcalBurnRate, row);
+  swapRemove(reward, row);
+  characters.eraseAt(row);
+}
+
+void CharacterStore::clear() {
+  while (size() > 0) {
+    eraseAt(size() - 1);
+  }
+}
+
+void CharacterStore::setTraits(size_t row, const CharacterTraits& traits) {
+  health[row] = traits.health;
+  healthRegenRate[row] = traits.health_regen_rate;
+  maxHealth[row] = traits.max_health;
+  kcalOnHand[row] = traits.kcal_on_hand;
+  kcalBurnRate[row] = traits.kcal_burn_rate;
+}
+
+void CharacterStore::metabolize(double elapsedTime, std::vector<size_t>& dead) {
+  const size_t n = size();
+  double* __restrict h = health.data();
+  double* __restrict kcal = kcalOnHand.data();
+  double* __restrict r = reward.data();
+  const double* __restrict regenRate = healthRegenRate.data();
+  const double* __restrict cap = maxHealth.data();
+  const double* __restrict burnRate = kcalBurnRate.data();
+
+  size_t i = 0;
+#if defined(__AVX__)
+  const __m256d dt4 = _mm256_set1_pd(elapsedTime);
+  const __m256d zero = _mm256_setzero_pd();
+  for (; i + 4 <= n; i += 4) {
+    __m256d hv = _mm256_loadu_pd(h + i);
+    __m256d kv = _mm256_loadu_pd(kcal + i);
+    __m256d rv = _mm256_loadu_pd(r + i);
+    __m256d capv = _mm256_loadu_pd(cap + i);
+
+    // burn, whatever kcal do not cover comes out of health
+    __m256d burn = _mm256_mul_pd(_mm256_loadu_pd(burnRate + i), dt4);
+    __m256d covered = _mm256_cmp_pd(kv, burn, _CMP_GT_OQ);
+    __m256d deficit = _mm256_andnot_pd(covered, _mm256_sub_pd(burn, kv));
+    kv = _mm256_and_pd(covered, _mm256_sub_pd(kv, burn));
+    hv = _mm256_sub_pd(hv, deficit);
+    rv = _mm256_sub_pd(rv, deficit);
+
+    // fed characters below their maximum regenerate
+    __m256d fed = _mm256_and_pd(_mm256_cmp_pd(kv, zero, _CMP_GT_OQ), _mm256_cmp_pd(hv, capv, _CMP_LT_OQ));
+    __m256d regen = _mm256_and_pd(fed, _mm256_mul_pd(_mm256_loadu_pd(regenRate + i), dt4));
+    rv = _mm256_add_pd(rv, regen);
+    hv = _mm256_blendv_pd(hv, _mm256_min_pd(_mm256_add_pd(hv, regen), capv), fed);
+
+    _mm256_storeu_pd(h + i, hv);
+    _mm256_storeu_pd(kcal + i, kv);
+    _mm256_storeu_pd(r + i, rv);
+
+    int died = _mm256_movemask_pd(_mm256_cmp_pd(hv, zero, _CMP_LE_OQ));
+    for (size_t k = 0; died; k++, died >>= 1) {
+      if (died & 1) {
+        dead.push_back(i + k);
+      }
+    }
+  }
+#endif
+  // remainder, or everything when no vector unit is available
+  for (; i < n; i++) {
+    metabolize(h[i], kcal[i], r[i], regenRate[i], cap[i], burnRate[i], elapsedTime);
+    if (h[i] <= 0) {
+      dead.push_back(i);
+    }
+  }
+}
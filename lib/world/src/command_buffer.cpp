@@ -0,0 +1,82 @@
+#include "command_buffer.hpp"
+#include "action_types.hpp"
+#include "gridworld.hpp"
+#include "random_stream.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+
+void SplitPolicy::resolve(const ActionDesc* group, size_t count, size_t tick, double* shares) const {
+  for (size_t i = 0; i < count; i++) {
+    shares[i] = 1.0 / count;
+  }
+}
+
+void PriorityPolicy::resolve(const ActionDesc* group, size_t count, size_t tick, double* shares) const {
+  // groups are sorted by subject, the first one has the lowest ID
+  for (size_t i = 0; i < count; i++) {
+    shares[i] = i == 0 ? 1.0 : 0.0;
+  }
+}
+
+void RandomPolicy::resolve(const ActionDesc* group, size_t count, size_t tick, double* shares) const {
+  // one stream per contested object and tick
+  RandomStream stream(seed, group[0].ObjectInstanceID, tick, RandomPurpose::ConflictResolution);
+  size_t winner = stream.below(count);
+  for (size_t i = 0; i < count; i++) {
+    shares[i] = i == winner ? 1.0 : 0.0;
+  }
+}
+
+ResolutionPolicyPtr makeResolutionPolicy(const std::string& name, size_t seed) {
+  if (name == "split") {
+    return std::make_unique<SplitPolicy>();
+  } else if (name == "priority") {
+    return std::make_unique<PriorityPolicy>();
+  } else if (name == "random") {
+    return std::make_unique<RandomPolicy>(seed);
+  }
+  throw std::invalid_argument("Unknown conflict resolution policy " + name);
+}
+
+void CommandBuffer::execute(GridWorld& world, const ResolutionPolicy& policy, size_t tick) {
+  auto key = [](const ActionDesc& action) {
+    return std::make_tuple(action.ActionID, action.ObjectClassID, action.ObjectInstanceID, action.SubjectInstanceID);
+  };
+  std::sort(commands.begin(), commands.end(), [&key](const ActionDesc& a, const ActionDesc& b) {
+    return key(a) < key(b);
+  });
+
+  shares.resize(commands.size());
+  size_t typeBegin = 0;
+  while (typeBegin < commands.size()) {
+    const size_t actionID = commands[typeBegin].ActionID;
+    size_t begin = typeBegin;
+    while (begin < commands.size() && commands[begin].ActionID == actionID) {
+      const ActionDesc& first = commands[begin];
+      size_t end = begin + 1;
+      while (end < commands.size() &&
+             commands[end].ActionID == actionID &&
+             commands[end].ObjectClassID == first.ObjectClassID &&
+             commands[end].ObjectInstanceID == first.ObjectInstanceID) {
+        end++;
+      }
+      policy.resolve(&commands[begin], end - begin, tick, &shares[begin]);
+      begin = end;
+    }
+
+    size_t count = begin - typeBegin;
+    if (!BuiltinActions::executeBatch(world, actionID, &commands[typeBegin], &shares[typeBegin], count)) {
+      // registered actions take object pointers, resolve tiles left unset by the decide phase
+      for (size_t i = typeBegin; i < begin; i++) {
+        if (!commands[i].object && commands[i].ObjectClassID == Tile::ElementID) {
+          commands[i].object = world.getTile(commands[i].ObjectInstanceID).get();
+        }
+      }
+      AbstractAction::executeBatch(world, actionID, &commands[typeBegin], &shares[typeBegin], count);
+    }
+    typeBegin = begin;
+  }
+  commands.clear();
+}
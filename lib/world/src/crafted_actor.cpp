@@ -3,30 +3,42 @@
 #include "move_action.hpp"
 #include "harvest_action.hpp"
 
-CraftedActor::CraftedActor(size_t charID):
+CraftedActor::CraftedActor(GridWorld& world, size_t charID):
     characterID(charID),
-    world(GridWorld::getInstance()) {
+    world(world),
+    randomActor(world.getRandomSeed()) {
   character = world.getCharacter(characterID);
+  world.enableResourceField();
 }
 
 CraftedActor::~CraftedActor() {}
 
 size_t CraftedActor::selectAction(const std::vector<ActionDesc>& actions) {
   // Get the tile the character is on
-  constTilePtr tile = character.lock()->getPosition();
-  const Resources& resources = tile->getResources();
+  constCharacterPtr self = character.lock();
+  const size_t tileID = self->getPosition()->getInstanceID();
+  const TileStore& tiles = world.getTileStore();
   // if the current tile has less resources than the character's burn rate, move to a new tile
-  if (resources.kcal < character.lock()->getTraits().kcal_burn_rate) {
+  if (tiles.getResources(tileID).kcal < self->getTraits().kcal_burn_rate) {
+    // head for the nearest tile above the resource threshold
+    size_t step = world.getResourceField()->nextStep(tileID);
+    if (step != ResourceField::None) {
+      for (size_t i = 0; i < actions.size(); i++) {
+        if (actions[i].slot == ActionSpace::FirstMove + step) {
+          return i;
+        }
+      }
+    }
+
+    // nothing above the threshold is reachable, try the richest neighbour
     const size_t moveActionID = MoveAction::ActionID;
     double max_kcal = 0;
     size_t max_kcal_action = 0;
     bool canMove = false;
     for (size_t i = 0; i < actions.size(); i++) {
-      if (actions[i].ActionID == moveActionID) {
+      if (actions[i].ActionID == moveActionID && actions[i].ObjectInstanceID != tileID) {
         canMove = true;
-        size_t newTileID = actions[i].object->getInstanceID();
-        const TilePtr& newTile = world.getTile(newTileID);
-        const Resources& newResources = newTile->getResources();
+        const Resources newResources = tiles.getResources(actions[i].ObjectInstanceID);
         if (newResources.kcal > max_kcal) {
           max_kcal = newResources.kcal;
           max_kcal_action = i;
@@ -52,4 +64,12 @@ size_t CraftedActor::selectAction(const std::vector<ActionDesc>& actions) {
   return randomActor.selectAction(actions);
 }
 
-void CraftedActor::update(double reward) {}
\ No newline at end of file
+void CraftedActor::update(double reward) {}
+
+void CraftedActor::save(std::ostream& out) const {
+  randomActor.save(out);
+}
+
+void CraftedActor::load(std::istream& in) {
+  randomActor.load(in);
+}
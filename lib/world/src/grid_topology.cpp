@@ -0,0 +1,67 @@
+#include "grid_topology.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+// steps between two offset coordinates of an odd-q hex map, via cube coordinates
+long hexDistance(long x0, long y0, long x1, long y1) {
+  long z0 = y0 - (x0 - (x0 & 1)) / 2;
+  long z1 = y1 - (x1 - (x1 & 1)) / 2;
+  long dx = x1 - x0;
+  long dz = z1 - z0;
+  return std::max({std::labs(dx), std::labs(dz), std::labs(dx + dz)});
+}
+}
+
+size_t GridTopology::getDistance(size_t tileID, size_t otherID) const {
+  const long x0 = static_cast<long>(tileID / height);
+  const long y0 = static_cast<long>(tileID % height);
+  const long x1 = static_cast<long>(otherID / height);
+  const long y1 = static_cast<long>(otherID % height);
+  const long w = static_cast<long>(width);
+  const long h = static_cast<long>(height);
+
+  if (neighbourhood == Neighbourhood::Hex) {
+    if (!toroidal) {
+      return static_cast<size_t>(hexDistance(x0, y0, x1, y1));
+    }
+    // the nearest of the wrapped copies, an even width keeps column parity
+    long best = hexDistance(x0, y0, x1, y1);
+    for (long sx = -w; sx <= w; sx += w) {
+      for (long sy = -h; sy <= h; sy += h) {
+        best = std::min(best, hexDistance(x0, y0, x1 + sx, y1 + sy));
+      }
+    }
+    return static_cast<size_t>(best);
+  }
+
+  long dx = std::labs(x1 - x0);
+  long dy = std::labs(y1 - y0);
+  if (toroidal) {
+    dx = std::min(dx, w - dx);
+    dy = std::min(dy, h - dy);
+  }
+  return static_cast<size_t>(neighbourhood == Neighbourhood::Moore ? std::max(dx, dy) : dx + dy);
+}
+
+Neighbourhood parseNeighbourhood(const std::string& name) {
+  if (name == "vonNeumann") {
+    return Neighbourhood::VonNeumann;
+  } else if (name == "moore") {
+    return Neighbourhood::Moore;
+  } else if (name == "hex") {
+    return Neighbourhood::Hex;
+  }
+  throw std::invalid_argument("Unknown neighbourhood: " + name);
+}
+
+bool parseToroidal(const std::string& name) {
+  if (name == "torus") {
+    return true;
+  } else if (name == "bounded") {
+    return false;
+  }
+  throw std::invalid_argument("Unknown topology: " + name);
+}
@@ -1,26 +1,58 @@
 #include "gridworld.hpp"
 #include "character.hpp" // Include the header file for the Character class
 
+#include "map_generator.hpp"
 #include "param_reader.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+namespace {
+// worlds are the only elements numbered process wide
+std::atomic<size_t> worldCount(0);
+}
+
 GridWorld::GridWorld()
-    : Element<GridWorld>(), 
-    width(data_management::ParamReader::getInstance().getParam<size_t>("GridWorld", "width", 10)),
-    height(data_management::ParamReader::getInstance().getParam<size_t>("GridWorld", "height", 10)),
-    randomSeed(data_management::ParamReader::getInstance().getParam<size_t>("GridWorld", "randomSeed", 0)),
-    tileCount(0) {
-  tiles.resize(width);
-  for (size_t i = 0; i < width; i++) {
-    tiles[i].resize(height);
+    : GridWorld(data_management::ParamReader::getInstance().getParam<size_t>("GridWorld", "width", 10),
+                data_management::ParamReader::getInstance().getParam<size_t>("GridWorld", "height", 10),
+                data_management::ParamReader::getInstance().getParam<size_t>("GridWorld", "randomSeed", 0)) {}
+
+GridWorld::GridWorld(size_t width, size_t height, size_t randomSeed)
+    : GridWorld(width, height, randomSeed, GridTopology(width, height,
+        parseNeighbourhood(data_management::ParamReader::getInstance().getParam<std::string>("GridWorld", "neighbourhood", "vonNeumann")),
+        parseToroidal(data_management::ParamReader::getInstance().getParam<std::string>("GridWorld", "topology", "torus")))) {}
+
+GridWorld::GridWorld(size_t width, size_t height, size_t randomSeed, const GridTopology& topology)
+    : Element<GridWorld>(worldCount++),
+    width(width),
+    height(height),
+    topology(topology),
+    spatialIndex(this->topology, tileStore, occupancy),
+    randomSeed(randomSeed),
+    tileCount(0),
+    characterCount(0),
+    tick(0),
+    resolutionPolicy(makeResolutionPolicy(
+        data_management::ParamReader::getInstance().getParam<std::string>("GridWorld", "conflictPolicy", "priority"),
+        randomSeed)),
+    observationsEnabled(false),
+    currentObservation(0),
+    observationStamp(0),
+    tileChangesSince(SIZE_MAX) {
+  std::string regeneration = data_management::ParamReader::getInstance().getParam<std::string>("GridWorld", "tileRegeneration", "lazy");
+  if (regeneration == "lazy") {
+    tileStore.setLazy(true);
+  } else if (regeneration != "eager") {
+    throw std::invalid_argument("Unknown tile regeneration mode: " + regeneration);
   }
 }
 
 GridWorld::~GridWorld() {
-  for (size_t i = 0; i < width; i++) {
-    for (size_t j = 0; j < height; j++) {
-      tiles[i][j].reset();
-    }
-  }
+  // characters hold views of the tiles they stand on
+  characters.clear();
+  tileViews.clear();
 }
 
 void GridWorld::addTilePrototypes(std::vector<ResourceManagerRef>& tile_prototypes,
@@ -37,79 +69,177 @@ void GridWorld::addTilePrototypes(std::vector<ResourceManagerRef>& tile_prototyp
 }
 
 void GridWorld::update(double elapsedTime) {
-  std::vector<ActionDesc> selectedActions;
-  for (auto& character : characters) {
-    if (!character.second->isActionPolicySet()) {
-      continue;
+  // decide phase: nothing in the world changes until every character has
+  // chosen, so all of them observe the same state and can decide in parallel
+  deciders.clear();
+  deciderBatches.clear();
+  for (const CharacterPtr& character : characters.getCharacters()) {
+    if (character->isActionPolicySet()) {
+      deciders.push_back(character.get());
+      deciderBatches.push_back(character->getActor()->getDecisionBatch());
+    }
+  }
+  if (availableActions.size() < deciders.size()) {
+    availableActions.resize(deciders.size());
+  }
+  actionChoices.resize(deciders.size());
+  auto decide = [&](size_t k) {
+    deciders[k]->getAvailableActions(availableActions[k]);
+    if (!deciderBatches[k]) {
+      actionChoices[k] = deciders[k]->getActor()->selectAction(availableActions[k]);
+    }
+  };
+  if (threadPool) {
+    threadPool->parallelFor(deciders.size(), decide);
+  } else {
+    for (size_t k = 0; k < deciders.size(); k++) {
+      decide(k);
     }
-    std::vector<ActionDesc> actions;
-    character.second->getAvailableActions(actions);
-    size_t action_choice = character.second->getActor()->selectAction(actions);
+  }
+  decideBatches();
+
+  // apply phase, serial and in the same order regardless of thread count
+  for (size_t k = 0; k < deciders.size(); k++) {
+    const std::vector<ActionDesc>& actions = availableActions[k];
+    size_t action_choice = actionChoices[k];
     if (action_choice >= actions.size()) {
       std::cerr << "Invalid action choice: " << action_choice 
-                << " by character " << character.first
+                << " by character " << deciders[k]->getInstanceID()
                 << " of " << actions.size() << " available actions, skipping character." << std::endl;
       continue;
     }
-    ActionDesc& action = actions[action_choice];
-    selectedActions.push_back(action);
+    commandBuffer.push(actions[action_choice]);
   }
 
-  //TODO: check for conflicts and resolve
+  // actions aimed at the same object are resolved together by the policy
+  commandBuffer.execute(*this, *resolutionPolicy, tick);
 
-  // execute actions
-  for (ActionDesc action : selectedActions) {
-    AbstractAction::execute(action.ActionID, action.subject, action.object);
+  // characters that die are kept around until their actors had a last update
+  std::vector<CharacterPtr> updated(characters.getCharacters().begin(), characters.getCharacters().end());
+  for (const CharacterPtr& character : updated) {
+    occupancy.move(character->getInstanceID(), character->getPosition()->getInstanceID());
+    spatialIndex.move(character->getInstanceID(), character->getPosition()->getInstanceID());
   }
 
-  // update position of characters
-  for (auto it = characters.begin(); it != characters.end(); ) {
-    size_t characterID = it->first;
-    size_t knownTileID = characterTileMap[characterID];
-    size_t newTileID = it->second->getPosition()->getInstanceID();
+  // metabolism of every character in one pass over the component arrays
+  deadRows.clear();
+  characters.metabolize(elapsedTime, deadRows);
+  for (size_t row = 0; row < characters.size(); row++) {
+    characters[row]->writeMetabolismData(characters.getTraits(row).kcal_burn_rate * elapsedTime);
+  }
 
-    if (knownTileID != newTileID) {
-      tileCharacterMap[knownTileID].erase(characterID);
-      tileCharacterMap[newTileID].insert(characterID);
-      characterTileMap[characterID] = newTileID;
-    }
+  // compact, from the back so only survivors are swapped into the holes
+  for (auto row = deadRows.rbegin(); row != deadRows.rend(); ++row) {
+    occupancy.remove(characters[*row]->getInstanceID());
+    spatialIndex.remove(characters[*row]->getInstanceID());
+    characters.eraseAt(*row);
+  }
 
-    it->second->update(elapsedTime);
+  tileStore.regenerate(elapsedTime);
+  syncObservations();
+  if (resourceField) {
+    resourceField->update(tileStore, tileStore.getDirtyTiles());
+  }
+  tileStore.clearDirty();
 
-    // if character's health is 0, remove character
-    if (it->second->getTraits().health <= 0) {
-      constTilePtr tile = it->second->getPosition();
-      tileCharacterMap[tile->getInstanceID()].erase(characterID);
-      characterTileMap.erase(characterID);
-      it = characters.erase(it); // Erase and update the iterator
-    } else {
-      ++it; // Only increment the iterator if no deletion occurred
+  // actors learn from the state their next decision will be made in
+  for (CharacterPtr& character : updated) {
+    character->updateActor();
+  }
+  updated.clear();
+  pruneTileViews();
+  tick++;
+}
+
+void GridWorld::decideBatches() {
+  // group the deciders in one pass
+  batchSlots.clear();
+  size_t batchCount = 0;
+  for (size_t k = 0; k < deciders.size(); k++) {
+    DecisionBatch* batch = deciderBatches[k];
+    if (!batch) {
+      continue;
+    }
+    auto slot = batchSlots.emplace(batch, batchCount);
+    if (slot.second) {
+      if (batchGroups.size() == batchCount) {
+        batchGroups.emplace_back();
+      }
+      BatchGroup& group = batchGroups[batchCount++];
+      group.batch = batch;
+      group.rows.clear();
+      group.actors.clear();
+      group.actions.clear();
     }
+    BatchGroup& group = batchGroups[slot.first->second];
+    group.rows.push_back(k);
+    group.actors.push_back(deciders[k]->getActor().get());
+    group.actions.push_back(&availableActions[k]);
   }
 
-  for (size_t i = 0; i < width; i++) {
-    for (size_t j = 0; j < height; j++) {
-      tiles[i][j]->update(elapsedTime);
+  // batches share no state, each decides for its own deciders
+  auto decide = [&](size_t slot) {
+    BatchGroup& group = batchGroups[slot];
+    group.choices.clear();
+    group.batch->selectActions(group.actors, group.actions, group.choices);
+    for (size_t i = 0; i < group.rows.size(); i++) {
+      actionChoices[group.rows[i]] = group.choices[i];
+    }
+  };
+  if (threadPool) {
+    threadPool->parallelFor(batchCount, decide);
+  } else {
+    for (size_t slot = 0; slot < batchCount; slot++) {
+      decide(slot);
     }
   }
 }
 
-TilePtr& GridWorld::getTile(Coord2D coord) {
-  return tiles[coord.first][coord.second];
+TilePtr GridWorld::getTile(Coord2D coord) {
+  return getTileView(getTileID(coord));
 }
 
-TilePtr& GridWorld::getTile(size_t tileID) {
-  Coord2D coord = getTileCoord(tileID);
-  return tiles[coord.first][coord.second];
+TilePtr GridWorld::getTile(size_t tileID) {
+  return getTileView(tileID);
 }
 
-const TilePtr& GridWorld::getTile(Coord2D coord) const {
-  return tiles[coord.first][coord.second];
+constTilePtr GridWorld::getTile(Coord2D coord) const {
+  return getTileView(getTileID(coord));
 }
 
-const TilePtr& GridWorld::getTile(size_t tileID) const {
-  Coord2D coord = getTileCoord(tileID);
-  return tiles[coord.first][coord.second];
+constTilePtr GridWorld::getTile(size_t tileID) const {
+  return getTileView(tileID);
+}
+
+TilePtr GridWorld::getTileView(size_t tileID) const {
+  if (tileID >= tileCount) {
+    throw std::out_of_range("Tile ID out of range: " + std::to_string(tileID));
+  }
+  {
+    std::shared_lock<std::shared_mutex> lock(tileViewMutex);
+    auto it = tileViews.find(tileID);
+    if (it != tileViews.end()) {
+      return it->second;
+    }
+  }
+  std::unique_lock<std::shared_mutex> lock(tileViewMutex);
+  TilePtr& view = tileViews[tileID];
+  if (!view) {
+    // views write through to the store, constness is enforced by the overloads above
+    GridWorld& world = const_cast<GridWorld&>(*this);
+    view = std::make_shared<Tile>(tileID, world, world.tileStore, tileID);
+  }
+  return view;
+}
+
+void GridWorld::pruneTileViews() {
+  for (auto it = tileViews.begin(); it != tileViews.end(); ) {
+    if (it->second.use_count() == 1) {
+      it = tileViews.erase(it);
+    } else {
+      ++it;
+    }
+  }
 }
 
 const int GridWorld::getWidth() const {
@@ -121,12 +251,11 @@ const int GridWorld::getHeight() const {
 }
 
 const size_t GridWorld::getTileID(Coord2D coord) const {
-  const TilePtr& tile = tiles[coord.first][coord.second];
-  return tile->getInstanceID();
+  return topology.getTileID(coord);
 }
 
 const Coord2D GridWorld::getTileCoord(size_t tileID) const {
-  return tileCoordMap.at(tileID);
+  return topology.getTileCoord(tileID);
 }
 
 const size_t GridWorld::getTileCount() const {
@@ -134,78 +263,164 @@ const size_t GridWorld::getTileCount() const {
 }
 
 void GridWorld::GenerateTileMap() {
-  std::mt19937 gen(randomSeed);
-  std::discrete_distribution<size_t> dist(weights.begin(), weights.end());
-
-  for (size_t i = 0; i < width; i++) {
-    for (size_t j = 0; j < height; j++) {
-      size_t index = dist(gen);
-      ResourceManager resources = tile_prototypes[index];
-      TilePtr tile(new Tile(resources));
-      Coord2D coord = std::make_pair(i, j);
-      tileCoordMap[tile->getInstanceID()] = coord;
-      tiles[i][j] = tile;
-      tileCount++;
+  MapGenerator generator(topology, randomSeed, weights,
+      parseMapLayout(data_management::ParamReader::getInstance().getParam<std::string>("GridWorld", "mapLayout", "uniform")),
+      data_management::ParamReader::getInstance().getParam<double>("GridWorld", "noiseScale", 32.0),
+      data_management::ParamReader::getInstance().getParam<size_t>("GridWorld", "noiseOctaves", 4));
+
+  // prototypes are shared, a tile only records which one it was drawn from
+  tileStore.clear();
+  for (const ResourceManager& prototype : tile_prototypes) {
+    tileStore.addPrototype(prototype);
+  }
+  tileStore.assignTiles(generator.generate(threadPool.get()));
+  tileCount = width * height;
+  occupancy.resize(tileCount);
+  spatialIndex.indexTiles();
+  if (resourceField) {
+    resourceField->build(tileStore);
+  }
+}
+
+size_t GridWorld::AddCharacter(CharacterTraits traits, Coord2D coord) {
+  size_t characterID = characterCount++;
+  CharacterPtr character = std::make_shared<Character>(characterID, traits);
+  TilePtr tile = getTile(coord);
+  character->setPosition(tile);
+  characterHandles.push_back(characters.insert(std::move(character)));
+  occupancy.insert(characterID, tile->getInstanceID());
+  spatialIndex.insert(characterID, tile->getInstanceID());
+  if (observationsEnabled) {
+    writeObservations(observationFrames[currentObservation], nullptr);
+  }
+  return characterID;
+}
+
+ActionMask GridWorld::getActionMask(size_t characterID) const {
+  return ActionSpace::getMask(topology, getCharacter(characterID)->getPosition()->getInstanceID());
+}
+
+ActionDesc GridWorld::decodeAction(size_t characterID, size_t slot) {
+  CharacterPtr character = getCharacter(characterID);
+  size_t tileID = character->getPosition()->getInstanceID();
+  if (!(ActionSpace::getMask(topology, tileID) & (1u << slot))) {
+    throw std::invalid_argument("Invalid action slot " + std::to_string(slot) + " for character " + std::to_string(characterID));
+  }
+  size_t targetID = ActionSpace::getTarget(topology, tileID, slot);
+  return ActionDesc{Character::ElementID, characterID, ActionSpace::getActionID(slot),
+                    Tile::ElementID, targetID, character.get(), getTile(targetID).get(), slot};
+}
+
+void GridWorld::writeActionFeatures(float* features, ActionMask* masks) const {
+  auto encode = [&](size_t row) {
+    const CharacterPtr& character = characters[row];
+    size_t tileID = character->getPosition()->getInstanceID();
+    masks[row] = ActionSpace::getMask(topology, tileID);
+    ActionSpace::writeFeatures(topology, character->getInstanceID(), tileID,
+                               features + row * ActionSpace::FeatureSize);
+  };
+  if (threadPool) {
+    threadPool->parallelFor(characters.size(), encode);
+  } else {
+    for (size_t row = 0; row < characters.size(); row++) {
+      encode(row);
     }
   }
+}
 
-  // establish adjacency
-  for (size_t i = 0; i < width; i++) {
-    for (size_t j = 0; j < height; j++) {
-      TilePtr& tile = tiles[i][j];
-      if (i > 0) {
-        tile->addAdjacentTile(tiles[i - 1][j]);
-      } else {
-        tile->addAdjacentTile(tiles[width - 1][j]);
-      }
-      if (i < width - 1) {
-        tile->addAdjacentTile(tiles[i + 1][j]);
-      } else {
-        tile->addAdjacentTile(tiles[0][j]);
-      }
-      if (j > 0) {
-        tile->addAdjacentTile(tiles[i][j - 1]);
-      } else {
-        tile->addAdjacentTile(tiles[i][height - 1]);
-      }
-      if (j < height - 1) {
-        tile->addAdjacentTile(tiles[i][j + 1]);
-      } else {
-        tile->addAdjacentTile(tiles[i][0]);
-      }
+void GridWorld::enableObservations() {
+  if (observationsEnabled) {
+    return;
+  }
+  observationsEnabled = true;
+  writeObservations(observationFrames[0], nullptr);
+  writeObservations(observationFrames[1], nullptr);
+}
+
+void GridWorld::findCharactersWithin(size_t radius, std::vector<std::vector<size_t>>& neighbours) const {
+  neighbours.resize(characters.size());
+  auto find = [&](size_t row) {
+    size_t characterID = characters[row]->getInstanceID();
+    std::vector<size_t>& found = neighbours[row];
+    found.clear();
+    spatialIndex.findCharacters(occupancy.getTile(characterID), radius, found);
+    found.erase(std::remove(found.begin(), found.end(), characterID), found.end());
+  };
+  if (threadPool) {
+    threadPool->parallelFor(characters.size(), find);
+  } else {
+    for (size_t row = 0; row < characters.size(); row++) {
+      find(row);
     }
   }
 }
 
-void GridWorld::AddCharacter(CharacterPtr character, Coord2D coord) {
-  TilePtr& tile = getTile(coord);
-  character->setPosition(tile);
-  size_t characterID = character->getInstanceID();
-  characters[characterID] = std::move(character);
-  size_t tileID = tile->getInstanceID();
-  tileCharacterMap[tileID].insert(characterID);
-  characterTileMap[characterID] = tileID;
-}
-
-std::unique_ptr<double[]> GridWorld::getTileFeatures() const {
-  size_t tile_feature_size = Tile::FeatureSize;
-  std::unique_ptr<double[]> features(new double[tileCount * tile_feature_size]);
-  for (size_t i = 0; i < tileCount; i++) {
-    Coord2D coord = tileCoordMap.at(i);
-    const TilePtr& tile = tiles[coord.first][coord.second];
-    std::unique_ptr<double[]> tile_features = tile->getFeatures();
-    std::copy(tile_features.get(), tile_features.get() + tile_feature_size, features.get() + i * tile_feature_size);
-  }
-  return features;
-}
-
-std::unique_ptr<double[]> GridWorld::getCharacterFeatures() const {
-  size_t character_feature_size = Character::FeatureSize;
-  std::unique_ptr<double[]> features(new double[characters.size() * character_feature_size]);
-  for (size_t i = 0; i < characters.size(); i++) {
-    Character* character = characters.at(i).get();
-    std::unique_ptr<double[]> character_features = character->getFeatures();
-    std::copy(character_features.get(), character_features.get() + character_feature_size, features.get() + i * character_feature_size);
-  }
-  return features;
-}
\ No newline at end of file
+void GridWorld::enableResourceField() {
+  if (resourceField) {
+    return;
+  }
+  double threshold = data_management::ParamReader::getInstance().getParam<double>("GridWorld", "resourceThreshold", 100.0);
+  resourceField = std::make_unique<ResourceField>(topology, threshold);
+  resourceField->build(tileStore);
+  // lazily regrowing tiles report crossing the threshold
+  tileStore.setWatchLevel(threshold);
+}
+
+void GridWorld::syncObservations() {
+  if (!observationsEnabled) {
+    return;
+  }
+  // the tiles changed this tick, lazily regrowing ones are not marked dirty
+  const std::vector<uint32_t>& dirtyTiles = tileStore.getDirtyTiles();
+  tileChanges.assign(dirtyTiles.begin(), dirtyTiles.end());
+  if (tileStore.isLazy()) {
+    const std::vector<uint32_t>& regrowing = tileStore.getActiveTiles();
+    tileChanges.insert(tileChanges.end(), regrowing.begin(), regrowing.end());
+  }
+  // the frame being written is the one published two syncs ago, it needs
+  // the tile changes of the previous tick as well as this one
+  size_t next = 1 - currentObservation;
+  ObservationFrame& frame = observationFrames[next];
+  previousDirtyTiles.insert(previousDirtyTiles.end(), tileChanges.begin(), tileChanges.end());
+  writeObservations(frame, &previousDirtyTiles);
+  previousDirtyTiles.assign(tileChanges.begin(), tileChanges.end());
+  currentObservation = next;
+  // against the frame published before, only this tick's tiles differ
+  tileChangesSince = observationStamp - 1;
+}
+
+const std::vector<uint32_t>* GridWorld::getTileChanges(size_t stamp) const {
+  static const std::vector<uint32_t> none;
+  if (stamp == observationStamp) {
+    return &none;
+  }
+  return stamp == tileChangesSince ? &tileChanges : nullptr;
+}
+
+void GridWorld::writeObservations(ObservationFrame& frame, const std::vector<uint32_t>* dirtyTiles) {
+  observationStamp++;
+  tileChangesSince = SIZE_MAX;
+  frame.grid.resize(FeatureSize);
+  std::unique_ptr<double[]> grid_features = getFeatures();
+  std::copy(grid_features.get(), grid_features.get() + FeatureSize, frame.grid.begin());
+
+  const size_t tile_feature_size = Tile::FeatureSize;
+  if (!dirtyTiles || frame.tiles.size() != tileCount * tile_feature_size) {
+    frame.tiles.resize(tileCount * tile_feature_size);
+    for (size_t i = 0; i < tileCount; i++) {
+      Tile::writeFeatures(*this, i, frame.tiles.data() + i * tile_feature_size);
+    }
+  } else {
+    // only the resources of a tile change after generation
+    for (uint32_t i : *dirtyTiles) {
+      frame.tiles[i * tile_feature_size + Tile::ResourcesFeature] = tileStore.getResources(i).kcal;
+    }
+  }
+
+  // every character changes every tick
+  const size_t character_feature_size = Character::FeatureSize;
+  frame.characters.resize(characters.size() * character_feature_size);
+  for (size_t row = 0; row < characters.size(); row++) {
+    characters[row]->writeFeatures(frame.characters.data() + row * character_feature_size);
+  }
+}
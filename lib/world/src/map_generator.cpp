@@ -0,0 +1,252 @@
+#include "map_generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "random_stream.hpp"
+
+namespace {
+// samples per axis the noise bands are fitted to
+constexpr size_t SampleSize = 256;
+
+// slots of the table that shortcuts the search for a value's band
+constexpr size_t GuideSize = 1024;
+
+// lattice points and cells per tile along one axis for cells of cellSize tiles
+std::pair<size_t, double> latticeAxis(size_t extent, double cellSize, bool toroidal) {
+  if (toroidal) {
+    // a whole number of cells around the map, so the last wraps onto the first
+    size_t cells = std::max<size_t>(1, static_cast<size_t>(std::lround(extent / cellSize)));
+    return {cells, static_cast<double>(cells) / extent};
+  }
+  double scale = 1.0 / cellSize;
+  return {static_cast<size_t>((extent - 1) * scale) + 2, scale};
+}
+}
+
+MapGenerator::MapGenerator(const GridTopology& topology,
+                           size_t seed,
+                           const std::vector<double>& weights,
+                           MapLayout layout,
+                           double noiseScale,
+                           size_t noiseOctaves) :
+    topology(topology),
+    seed(seed),
+    layout(layout),
+    noiseScale(noiseScale),
+    noiseOctaves(noiseOctaves),
+    chunkRows((topology.getHeight() + ChunkSize - 1) / ChunkSize) {
+  double total = 0;
+  for (double weight : weights) {
+    if (weight < 0) {
+      throw std::invalid_argument("Tile prototype weights must not be negative");
+    }
+    total += weight;
+  }
+  if (weights.empty() || total <= 0) {
+    throw std::invalid_argument("At least one tile prototype needs a positive weight");
+  }
+  if (weights.size() > std::numeric_limits<TileStore::PrototypeIndex>::max()) {
+    throw std::length_error("Too many tile prototypes");
+  }
+  if (layout == MapLayout::Noise && (noiseScale < 1 || noiseOctaves == 0)) {
+    throw std::invalid_argument("Noise needs a scale of at least one tile and at least one octave");
+  }
+  double sum = 0;
+  for (double weight : weights) {
+    sum += weight;
+    shares.push_back(sum / total);
+  }
+  shares.back() = 1.0;
+}
+
+std::vector<TileStore::PrototypeIndex> MapGenerator::generate(ThreadPool* pool) {
+  if (layout == MapLayout::Noise) {
+    buildOctaves(pool);
+    fitBands();
+  } else {
+    bands = shares;
+  }
+  // nothing may fall past the last band, whatever rounding does
+  bands.back() = std::numeric_limits<double>::infinity();
+  buildGuide();
+
+  std::vector<TileStore::PrototypeIndex> prototypes(topology.getTileCount());
+  size_t chunkCount = (topology.getWidth() + ChunkSize - 1) / ChunkSize * chunkRows;
+  auto fill = [&](size_t chunk) {
+    fillChunk(chunk, prototypes);
+  };
+  if (pool) {
+    pool->parallelFor(chunkCount, fill);
+  } else {
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+      fill(chunk);
+    }
+  }
+  octaves.clear();
+  return prototypes;
+}
+
+void MapGenerator::buildOctaves(ThreadPool* pool) {
+  octaves.clear();
+  double cellSize = noiseScale;
+  double amplitude = 1.0;
+  // octaves finer than a tile would only add aliasing
+  for (size_t index = 0; index < noiseOctaves && cellSize >= 1; index++) {
+    Octave octave;
+    std::tie(octave.columns, octave.xScale) = latticeAxis(topology.getWidth(), cellSize, topology.isToroidal());
+    std::tie(octave.rows, octave.yScale) = latticeAxis(topology.getHeight(), cellSize, topology.isToroidal());
+    octave.amplitude = amplitude;
+    octave.values.resize(octave.columns * octave.rows);
+    // one stream per lattice column and octave
+    auto draw = [&](size_t column) {
+      RandomStream stream(seed, column, index, RandomPurpose::MapNoise);
+      float* values = octave.values.data() + column * octave.rows;
+      for (size_t row = 0; row < octave.rows; row++) {
+        values[row] = static_cast<float>(stream.uniform());
+      }
+    };
+    if (pool) {
+      pool->parallelFor(octave.columns, draw);
+    } else {
+      for (size_t column = 0; column < octave.columns; column++) {
+        draw(column);
+      }
+    }
+    octaves.push_back(std::move(octave));
+    cellSize /= 2;
+    amplitude /= 2;
+  }
+}
+
+void MapGenerator::fitBands() {
+  const size_t width = topology.getWidth();
+  const size_t height = topology.getHeight();
+  size_t sampleColumns = std::min(width, SampleSize);
+  size_t sampleRows = std::min(height, SampleSize);
+  std::vector<RowTerm> rows(octaves.size());
+  std::vector<double> samples;
+  samples.reserve(sampleColumns * sampleRows);
+  for (size_t j = 0; j < sampleRows; j++) {
+    size_t y = (2 * j + 1) * height / (2 * sampleRows);
+    rowTerms(y, y + 1, rows.data());
+    for (size_t i = 0; i < sampleColumns; i++) {
+      double value;
+      noiseColumn((2 * i + 1) * width / (2 * sampleColumns), 1, rows.data(), &value);
+      samples.push_back(value);
+    }
+  }
+  std::sort(samples.begin(), samples.end());
+  bands.resize(shares.size());
+  for (size_t k = 0; k < shares.size(); k++) {
+    size_t rank = static_cast<size_t>(shares[k] * samples.size());
+    // a prototype with no share at the start must not catch the lowest values
+    bands[k] = rank == 0 ? -std::numeric_limits<double>::infinity()
+                         : samples[std::min(rank, samples.size() - 1)];
+  }
+}
+
+void MapGenerator::rowTerms(size_t begin, size_t end, RowTerm* out) const {
+  for (const Octave& octave : octaves) {
+    for (size_t y = begin; y < end; y++, out++) {
+      double fy = y * octave.yScale;
+      size_t iy = static_cast<size_t>(fy);
+      double ty = fy - iy;
+      out->first = static_cast<uint32_t>(iy % octave.rows);
+      out->second = static_cast<uint32_t>((iy + 1) % octave.rows);
+      out->weight = ty * ty * (3 - 2 * ty);
+    }
+  }
+}
+
+void MapGenerator::noiseColumn(size_t x, size_t span, const RowTerm* rows, double* out) const {
+  std::fill(out, out + span, 0.0);
+  for (const Octave& octave : octaves) {
+    double fx = x * octave.xScale;
+    size_t ix = static_cast<size_t>(fx);
+    double tx = fx - ix;
+    double sx = tx * tx * (3 - 2 * tx);
+    const float* left = octave.values.data() + (ix % octave.columns) * octave.rows;
+    const float* right = octave.values.data() + ((ix + 1) % octave.columns) * octave.rows;
+    for (size_t k = 0; k < span; k++, rows++) {
+      double a = left[rows->first] + (left[rows->second] - left[rows->first]) * rows->weight;
+      double b = right[rows->first] + (right[rows->second] - right[rows->first]) * rows->weight;
+      out[k] += octave.amplitude * (a + (b - a) * sx);
+    }
+  }
+}
+
+void MapGenerator::fillChunk(size_t chunk, std::vector<TileStore::PrototypeIndex>& out) const {
+  const size_t height = topology.getHeight();
+  size_t xBegin = chunk / chunkRows * ChunkSize;
+  size_t xEnd = std::min(xBegin + ChunkSize, topology.getWidth());
+  size_t yBegin = chunk % chunkRows * ChunkSize;
+  size_t yEnd = std::min(yBegin + ChunkSize, height);
+
+  if (layout == MapLayout::Uniform) {
+    // 32 bits per tile, plenty to split between prototypes
+    RandomStream stream(seed, chunk, 0, RandomPurpose::MapGeneration);
+    for (size_t x = xBegin; x < xEnd; x++) {
+      for (size_t y = yBegin; y < yEnd; y++) {
+        out[x * height + y] = pick(stream() / 4294967296.0);
+      }
+    }
+    return;
+  }
+  // the lattice rows and weights are the same for every column of the chunk
+  std::vector<RowTerm> rows(octaves.size() * (yEnd - yBegin));
+  rowTerms(yBegin, yEnd, rows.data());
+  double noise[ChunkSize];
+  for (size_t x = xBegin; x < xEnd; x++) {
+    noiseColumn(x, yEnd - yBegin, rows.data(), noise);
+    for (size_t y = yBegin; y < yEnd; y++) {
+      out[x * height + y] = pick(noise[y - yBegin]);
+    }
+  }
+}
+
+void MapGenerator::buildGuide() {
+  // draws are in [0, 1), the noise below the sum of the amplitudes
+  guideLow = 0.0;
+  double high = 1.0;
+  if (layout == MapLayout::Noise) {
+    high = 0.0;
+    for (const Octave& octave : octaves) {
+      high += octave.amplitude;
+    }
+  }
+  guideScale = GuideSize / (high - guideLow);
+  guide.resize(GuideSize);
+  size_t band = 0;
+  for (size_t slot = 0; slot < GuideSize; slot++) {
+    double start = guideLow + slot / guideScale;
+    while (bands[band] <= start) {
+      band++;
+    }
+    guide[slot] = static_cast<TileStore::PrototypeIndex>(band);
+  }
+}
+
+TileStore::PrototypeIndex MapGenerator::pick(double value) const {
+  // the guide gives the band at the start of the value's slot, at most a
+  // few bands end inside the slot
+  double slot = (value - guideLow) * guideScale;
+  size_t band = guide[slot <= 0 ? 0 : std::min(static_cast<size_t>(slot), GuideSize - 1)];
+  while (value >= bands[band]) {
+    band++;
+  }
+  return static_cast<TileStore::PrototypeIndex>(band);
+}
+
+MapLayout parseMapLayout(const std::string& name) {
+  if (name == "uniform") {
+    return MapLayout::Uniform;
+  } else if (name == "noise") {
+    return MapLayout::Noise;
+  }
+  throw std::invalid_argument("Unknown map layout: " + name);
+}
@@ -0,0 +1,124 @@
+#include "resource_field.hpp"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+
+ResourceField::ResourceField(const GridTopology& topology, double threshold) :
+    topology(topology),
+    threshold(threshold) {}
+
+void ResourceField::build(const TileStore& store) {
+  distance.assign(store.size(), Unreachable);
+  source.assign(store.size(), 0);
+  queue.clear();
+  for (size_t tileID = 0; tileID < store.size(); tileID++) {
+    if (store.getResources(tileID).kcal >= threshold) {
+      source[tileID] = 1;
+      distance[tileID] = 0;
+      queue.emplace_back(0, static_cast<uint32_t>(tileID));
+    }
+  }
+  // every source starts at 0, a plain FIFO visits tiles in distance order
+  for (size_t head = 0; head < queue.size(); head++) {
+    uint32_t tileID = queue[head].second;
+    uint32_t next = distance[tileID] + 1;
+    topology.forEachNeighbour(tileID, [&](size_t neighbourID) {
+      if (next < distance[neighbourID]) {
+        distance[neighbourID] = next;
+        queue.emplace_back(next, static_cast<uint32_t>(neighbourID));
+      }
+    });
+  }
+  queue.clear();
+}
+
+void ResourceField::update(const TileStore& store, const std::vector<uint32_t>& changed) {
+  cleared.clear();
+  frontier.clear();
+  queue.clear();
+
+  for (uint32_t tileID : changed) {
+    uint8_t isSource = store.getResources(tileID).kcal >= threshold;
+    if (isSource == source[tileID]) {
+      continue;
+    }
+    source[tileID] = isSource;
+    if (isSource) {
+      distance[tileID] = 0;
+      queue.emplace_back(0, tileID);
+    } else {
+      // its old distance was 0, everything counted from it is suspect
+      frontier.emplace_back(0, tileID);
+      distance[tileID] = Unreachable;
+      cleared.push_back(tileID);
+    }
+  }
+
+  // clear every tile whose distance may have been counted from a lost
+  // source, that is every tile reached by stepping to a distance one higher
+  for (size_t head = 0; head < frontier.size(); head++) {
+    uint32_t dependent = frontier[head].first + 1;
+    topology.forEachNeighbour(frontier[head].second, [&](size_t neighbourID) {
+      if (distance[neighbourID] == dependent && !source[neighbourID]) {
+        distance[neighbourID] = Unreachable;
+        cleared.push_back(static_cast<uint32_t>(neighbourID));
+        frontier.emplace_back(dependent, static_cast<uint32_t>(neighbourID));
+      }
+    });
+  }
+
+  // refill cleared tiles from their intact neighbours
+  for (uint32_t tileID : cleared) {
+    uint32_t best = Unreachable;
+    topology.forEachNeighbour(tileID, [&](size_t neighbourID) {
+      if (distance[neighbourID] != Unreachable) {
+        best = std::min(best, distance[neighbourID] + 1);
+      }
+    });
+    if (best < distance[tileID]) {
+      distance[tileID] = best;
+      queue.emplace_back(best, tileID);
+    }
+  }
+  propagate();
+}
+
+size_t ResourceField::nextStep(size_t tileID) const {
+  if (distance[tileID] == 0 || distance[tileID] == Unreachable) {
+    return None;
+  }
+  std::array<size_t, GridTopology::MaxNeighbours> directions;
+  size_t directionCount = topology.getDirections(tileID, directions);
+  size_t step = None;
+  uint32_t best = distance[tileID];
+  for (size_t direction = 0; direction < directionCount; direction++) {
+    size_t neighbourID = directions[direction];
+    if (neighbourID != GridTopology::NoNeighbour && distance[neighbourID] < best) {
+      best = distance[neighbourID];
+      step = direction;
+    }
+  }
+  return step;
+}
+
+void ResourceField::propagate() {
+  // distances start out mixed, so the queue is a min-heap
+  std::make_heap(queue.begin(), queue.end(), std::greater<Entry>());
+  while (!queue.empty()) {
+    std::pop_heap(queue.begin(), queue.end(), std::greater<Entry>());
+    Entry entry = queue.back();
+    queue.pop_back();
+    if (entry.first > distance[entry.second]) {
+      continue;
+    }
+    uint32_t next = entry.first + 1;
+    topology.forEachNeighbour(entry.second, [&](size_t neighbourID) {
+      if (next < distance[neighbourID]) {
+        distance[neighbourID] = next;
+        queue.emplace_back(next, static_cast<uint32_t>(neighbourID));
+        std::push_heap(queue.begin(), queue.end(), std::greater<Entry>());
+      }
+    });
+  }
+}
@@ -0,0 +1,56 @@
+#include "rollout_actor.hpp"
+
+#include <array>
+
+#include "param_reader.hpp"
+#include "random_stream.hpp"
+#include "world_fork.hpp"
+
+RolloutActor::RolloutActor(const GridWorld& world, size_t charID) :
+    characterID(charID),
+    world(world),
+    rollouts(data_management::ParamReader::getInstance().getParam<size_t>("RolloutActor", "rollouts", 8)),
+    depth(data_management::ParamReader::getInstance().getParam<size_t>("RolloutActor", "depth", 24)),
+    frameTime(data_management::ParamReader::getInstance().getParam<double>("Data", "frame_time", 1.0)) {}
+
+RolloutActor::~RolloutActor() {}
+
+size_t RolloutActor::selectAction(const std::vector<ActionDesc>& actions) {
+  // one stream for every rollout of this decision, keyed like any other draw
+  // of the character so parallel decisions stay reproducible
+  RandomStream stream(world.getRandomSeed(), characterID, world.getTick(), RandomPurpose::Rollout);
+  const WorldFork root(world, {characterID});
+  const double startReward = root.getReward(characterID);
+
+  size_t best = 0;
+  double bestReward = 0;
+  for (size_t i = 0; i < actions.size(); i++) {
+    double total = 0;
+    for (size_t r = 0; r < rollouts; r++) {
+      WorldFork rollout = root.fork();
+      rollout.act(characterID, actions[i].slot);
+      rollout.update(frameTime);
+      for (size_t step = 0; step < depth && rollout.isAlive(characterID); step++) {
+        // random valid slot
+        std::array<size_t, ActionSpace::Size> valid;
+        size_t count = 0;
+        ActionMask mask = rollout.getActionMask(characterID);
+        for (size_t slot = 0; slot < ActionSpace::Size; slot++) {
+          if (mask & (1u << slot)) {
+            valid[count++] = slot;
+          }
+        }
+        rollout.act(characterID, valid[stream.below(count)]);
+        rollout.update(frameTime);
+      }
+      total += rollout.getReward(characterID) - startReward;
+    }
+    if (i == 0 || total > bestReward) {
+      best = i;
+      bestReward = total;
+    }
+  }
+  return best;
+}
+
+void RolloutActor::update(double reward) {}
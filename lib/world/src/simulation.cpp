@@ -0,0 +1,28 @@
+#include "simulation.hpp"
+
+#include "gridworld.hpp"
+#include "data_writer.hpp"
+
+Simulation::Simulation(double frameTime) :
+    frameTime(frameTime) {}
+
+void Simulation::addWorld(GridWorld& world) {
+  worlds.push_back(world);
+}
+
+bool Simulation::step() {
+  data_management::DataWriter& writer = data_management::DataWriter::getInstance();
+  bool anyAlive = false;
+  for (GridWorld& model : worlds) {
+    model.update(frameTime);
+    anyAlive = anyAlive || model.hasLivingCharacters();
+  }
+  timeAccumulator += frameTime;
+  tickCount++;
+  writer.endLine();
+  if (!anyAlive) {
+    return false;
+  }
+  writer.writeData("Time Elapsed", data_management::DataType::DOUBLE, timeAccumulator);
+  return true;
+}
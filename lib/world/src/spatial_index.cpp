@@ -0,0 +1,159 @@
+#include "spatial_index.hpp"
+
+#include <algorithm>
+
+SpatialIndex::SpatialIndex(const GridTopology& topology, const TileStore& tiles, const OccupancyIndex& occupancy) :
+    topology(topology),
+    tiles(tiles),
+    occupancy(occupancy),
+    width(topology.getWidth()),
+    height(topology.getHeight()),
+    bucketColumns((topology.getWidth() + BucketSize - 1) / BucketSize),
+    bucketRows((topology.getHeight() + BucketSize - 1) / BucketSize) {
+  clear();
+  bucketCap.assign(bucketColumns * bucketRows, 0.0);
+}
+
+void SpatialIndex::clear() {
+  characters = OccupancyIndex();
+  characters.resize(bucketColumns * bucketRows);
+}
+
+void SpatialIndex::indexTiles() {
+  bucketCap.assign(bucketColumns * bucketRows, 0.0);
+  for (size_t tileID = 0; tileID < tiles.size(); tileID++) {
+    double& cap = bucketCap[bucketOf(tileID)];
+    cap = std::max(cap, tiles.getMaxResources(tileID).kcal);
+  }
+}
+
+void SpatialIndex::bucketSpan(size_t centre, size_t radius, size_t extent, std::vector<size_t>& out) const {
+  const size_t buckets = (extent + BucketSize - 1) / BucketSize;
+  out.clear();
+  if (!topology.isToroidal()) {
+    size_t low = centre > radius ? centre - radius : 0;
+    size_t high = std::min(centre + radius, extent - 1);
+    for (size_t bucket = low / BucketSize; bucket <= high / BucketSize; bucket++) {
+      out.push_back(bucket);
+    }
+    return;
+  }
+  if (2 * radius + 1 >= extent) {
+    for (size_t bucket = 0; bucket < buckets; bucket++) {
+      out.push_back(bucket);
+    }
+    return;
+  }
+  // walk the wrapped range a bucket at a time, a short map may see one twice
+  long position = static_cast<long>(centre) - static_cast<long>(radius);
+  const long end = static_cast<long>(centre + radius);
+  const long size = static_cast<long>(extent);
+  while (position <= end) {
+    size_t wrapped = static_cast<size_t>(((position % size) + size) % size);
+    size_t bucket = wrapped / BucketSize;
+    if (std::find(out.begin(), out.end(), bucket) == out.end()) {
+      out.push_back(bucket);
+    }
+    size_t bucketEnd = std::min((bucket + 1) * BucketSize, extent);
+    position += static_cast<long>(bucketEnd - wrapped);
+  }
+}
+
+template <class F>
+void SpatialIndex::forEachBucket(size_t tileID, size_t radius, F&& f) const {
+  std::vector<size_t> columns;
+  std::vector<size_t> rows;
+  bucketSpan(tileID / height, radius, width, columns);
+  bucketSpan(tileID % height, radius, height, rows);
+  for (size_t column : columns) {
+    for (size_t row : rows) {
+      f(column * bucketRows + row);
+    }
+  }
+}
+
+void SpatialIndex::findCharacters(size_t tileID, size_t radius, std::vector<size_t>& out) const {
+  forEachBucket(tileID, radius, [&](size_t bucket) {
+    characters.forEachOnTile(bucket, [&](size_t characterID) {
+      if (topology.getDistance(tileID, occupancy.getTile(characterID)) <= radius) {
+        out.push_back(characterID);
+      }
+    });
+  });
+}
+
+void SpatialIndex::findTiles(size_t tileID, size_t radius, double minKcal, std::vector<size_t>& out) const {
+  forEachBucket(tileID, radius, [&](size_t bucket) {
+    if (bucketCap[bucket] < minKcal) {
+      return;
+    }
+    size_t firstColumn = bucket / bucketRows * BucketSize;
+    size_t firstRow = bucket % bucketRows * BucketSize;
+    size_t lastColumn = std::min(firstColumn + BucketSize, width);
+    size_t lastRow = std::min(firstRow + BucketSize, height);
+    for (size_t x = firstColumn; x < lastColumn; x++) {
+      for (size_t y = firstRow; y < lastRow; y++) {
+        size_t otherID = x * height + y;
+        if (topology.getDistance(tileID, otherID) <= radius && tiles.getResources(otherID).kcal >= minKcal) {
+          out.push_back(otherID);
+        }
+      }
+    }
+  });
+}
+
+template <class Find>
+void SpatialIndex::findNearest(size_t k, std::vector<size_t>& out, Find&& find) const {
+  if (k == 0) {
+    return;
+  }
+  // the k nearest within a radius are the k nearest overall, double the
+  // radius until there are k or it spans the map
+  std::vector<size_t> found;
+  for (size_t radius = BucketSize / 2; ; radius *= 2) {
+    found.clear();
+    find(radius, found);
+    if (found.size() >= k || radius >= width + height) {
+      break;
+    }
+  }
+  std::vector<std::pair<size_t, size_t>> ranked;
+  ranked.reserve(found.size());
+  for (size_t id : found) {
+    ranked.emplace_back(find.distance(id), id);
+  }
+  size_t count = std::min(k, ranked.size());
+  std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end());
+  for (size_t i = 0; i < count; i++) {
+    out.push_back(ranked[i].second);
+  }
+}
+
+void SpatialIndex::findNearestCharacters(size_t tileID, size_t k, std::vector<size_t>& out) const {
+  struct {
+    const SpatialIndex& index;
+    size_t tileID;
+    void operator()(size_t radius, std::vector<size_t>& found) const {
+      index.findCharacters(tileID, radius, found);
+    }
+    size_t distance(size_t characterID) const {
+      return index.topology.getDistance(tileID, index.occupancy.getTile(characterID));
+    }
+  } find{*this, tileID};
+  findNearest(k, out, find);
+}
+
+void SpatialIndex::findNearestTiles(size_t tileID, size_t k, double minKcal, std::vector<size_t>& out) const {
+  struct {
+    const SpatialIndex& index;
+    size_t tileID;
+    double minKcal;
+    void operator()(size_t radius, std::vector<size_t>& found) const {
+      index.findTiles(tileID, radius, minKcal, found);
+    }
+    size_t distance(size_t otherID) const {
+      return index.topology.getDistance(tileID, otherID);
+    }
+  } find{*this, tileID, minKcal};
+  findNearest(k, out, find);
+}
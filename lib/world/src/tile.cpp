@@ -1,5 +1,64 @@
 #include "tile.hpp"
+#include "tile_store.hpp"
+#include "gridworld.hpp"
+
+namespace {
+template <class T>
+void writeTileFeatures(const GridWorld& world, size_t tileID, T* features) {
+  const TileStore& store = world.getTileStore();
+  features[0] = Tile::ElementID;
+  features[1] = tileID;
+  size_t slot = 2;
+  world.getTopology().forEachNeighbour(tileID, [&](size_t neighbourID) {
+    features[slot++] = neighbourID;
+  });
+  for (; slot < Tile::ResourcesFeature; slot++) {
+    features[slot] = -1;
+  }
+  features[Tile::ResourcesFeature] = store.getResources(tileID).kcal;
+  features[Tile::ResourcesFeature + 1] = store.getResourcesPerHour(tileID).kcal;
+  features[Tile::ResourcesFeature + 2] = store.getMaxResources(tileID).kcal;
+}
+}
+
+std::unique_ptr<double[]> Tile::getFeatures() const {
+  std::unique_ptr<double[]> features(new double[FeatureSize]);
+  writeTileFeatures(world, getInstanceID(), features.get());
+  return features;
+}
+
+void Tile::writeFeatures(float* features) const {
+  writeTileFeatures(world, getInstanceID(), features);
+}
+
+void Tile::writeFeatures(const GridWorld& world, size_t tileID, float* features) {
+  writeTileFeatures(world, tileID, features);
+}
+
+std::vector<TilePtr> Tile::getAdjacentTiles() const {
+  std::vector<TilePtr> adjacentTiles;
+  world.getTopology().forEachNeighbour(getInstanceID(), [&](size_t neighbourID) {
+    adjacentTiles.push_back(world.getTile(neighbourID));
+  });
+  return adjacentTiles;
+}
+
+Resources Tile::getResources() const {
+  return store.getResources(index);
+}
+
+void Tile::setResources(const Resources& resources) {
+  store.setResources(index, resources);
+}
+
+Resources Tile::getResourcesPerHour() const {
+  return store.getResourcesPerHour(index);
+}
+
+Resources Tile::getMaxResources() const {
+  return store.getMaxResources(index);
+}
 
 void Tile::update(double elapsedTime) {
-  resources.update(elapsedTime);
+  store.regenerate(index, elapsedTime);
 }
\ No newline at end of file
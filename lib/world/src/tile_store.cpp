@@ -0,0 +1,179 @@
+#include "tile_store.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+void TileStore::setLazy(bool lazy) {
+  if (this->lazy == lazy) {
+    return;
+  }
+  for (uint32_t index : active) {
+    materialize(index);
+  }
+  this->lazy = lazy;
+  rebuildSchedule();
+}
+
+void TileStore::setWatchLevel(double level) {
+  watchLevel = level;
+  rebuildSchedule();
+}
+
+void TileStore::reserve(size_t count) {
+  resources.reserve(count);
+  prototypeOf.reserve(count);
+  activeSlot.reserve(count);
+}
+
+void TileStore::clear() {
+  resources.clear();
+  prototypeOf.clear();
+  activeSlot.clear();
+  prototypeInitial.clear();
+  prototypeRate.clear();
+  prototypeCap.clear();
+  active.clear();
+  activeSince.clear();
+  dirty.clear();
+  events.clear();
+  clock = 0.0;
+}
+
+TileStore::PrototypeIndex TileStore::addPrototype(const ResourceManager& prototype) {
+  if (prototypeRate.size() > std::numeric_limits<PrototypeIndex>::max()) {
+    throw std::length_error("Too many tile prototypes");
+  }
+  prototypeInitial.push_back(prototype.resources.kcal);
+  prototypeRate.push_back(prototype.resourcesPerHour.kcal);
+  prototypeCap.push_back(prototype.maxResources.kcal);
+  return static_cast<PrototypeIndex>(prototypeRate.size() - 1);
+}
+
+size_t TileStore::addTile(PrototypeIndex prototype) {
+  resources.push_back(static_cast<float>(prototypeInitial[prototype]));
+  prototypeOf.push_back(prototype);
+  activeSlot.push_back(None);
+  // new tiles are not dirty, observations of a fresh map are built in full
+  size_t index = resources.size() - 1;
+  activate(index);
+  return index;
+}
+
+void TileStore::assignTiles(std::vector<PrototypeIndex>&& prototypes) {
+  prototypeOf = std::move(prototypes);
+  resources.resize(prototypeOf.size());
+  activeSlot.assign(prototypeOf.size(), None);
+  active.clear();
+  activeSince.clear();
+  events.clear();
+  // in index order, the same store as adding the tiles one by one
+  for (size_t index = 0; index < prototypeOf.size(); index++) {
+    resources[index] = static_cast<float>(prototypeInitial[prototypeOf[index]]);
+    activate(index);
+  }
+}
+
+void TileStore::regenerate(size_t index, double elapsedTime) {
+  materialize(index);
+  double cap = prototypeCap[prototypeOf[index]];
+  resources[index] = static_cast<float>(std::min(resources[index] + prototypeRate[prototypeOf[index]] * elapsedTime, cap));
+  touch(index);
+}
+
+void TileStore::retire(size_t slot) {
+  uint32_t index = active[slot];
+  active[slot] = active.back();
+  activeSince[slot] = activeSince.back();
+  activeSlot[active[slot]] = static_cast<uint32_t>(slot);
+  active.pop_back();
+  activeSince.pop_back();
+  activeSlot[index] = None;
+}
+
+void TileStore::regenerate(double elapsedTime) {
+  clock += elapsedTime;
+  if (lazy) {
+    // only tiles whose event came need a visit
+    visited.clear();
+    while (!events.empty() && events.front().time <= clock) {
+      Event event = events.front();
+      std::pop_heap(events.begin(), events.end(), later);
+      events.pop_back();
+      uint32_t index = event.index;
+      if (activeSlot[index] == None || nextEvent(index) != event.time) {
+        continue;
+      }
+      dirty.push_back(index);
+      bool saturated = currentResources(index) >= prototypeCap[prototypeOf[index]];
+      materialize(index);
+      if (saturated) {
+        retire(activeSlot[index]);
+      } else {
+        visited.push_back(index);
+      }
+    }
+    // after the loop, an event rounded to just short of its level must not
+    // come due again in the same regeneration
+    for (uint32_t index : visited) {
+      schedule(index);
+    }
+    return;
+  }
+  // tiles at their cap never change, only the active ones need a visit
+  for (size_t k = 0; k < active.size(); ) {
+    uint32_t index = active[k];
+    PrototypeIndex prototype = prototypeOf[index];
+    dirty.push_back(index);
+    resources[index] = static_cast<float>(std::min(resources[index] + prototypeRate[prototype] * elapsedTime,
+                                                   prototypeCap[prototype]));
+    if (resources[index] >= prototypeCap[prototype]) {
+      retire(k);
+    } else {
+      k++;
+    }
+  }
+}
+
+double TileStore::nextEvent(size_t index) const {
+  PrototypeIndex prototype = prototypeOf[index];
+  double rate = prototypeRate[prototype];
+  if (rate <= 0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  double value = resources[index];
+  double cap = prototypeCap[prototype];
+  double level = value < watchLevel && watchLevel < cap ? watchLevel : cap;
+  return activeSince[activeSlot[index]] + (level - value) / rate;
+}
+
+void TileStore::schedule(size_t index) {
+  if (!lazy) {
+    return;
+  }
+  // every write leaves an outdated event behind, drop them before they pile up
+  if (events.size() > 2 * active.size() + 64) {
+    rebuildSchedule();
+    return;
+  }
+  double time = nextEvent(index);
+  if (time != std::numeric_limits<double>::infinity()) {
+    events.push_back(Event{time, static_cast<uint32_t>(index)});
+    std::push_heap(events.begin(), events.end(), later);
+  }
+}
+
+void TileStore::rebuildSchedule() {
+  events.clear();
+  if (!lazy) {
+    return;
+  }
+  for (uint32_t index : active) {
+    double time = nextEvent(index);
+    if (time != std::numeric_limits<double>::infinity()) {
+      events.push_back(Event{time, index});
+    }
+  }
+  std::make_heap(events.begin(), events.end(), later);
+}
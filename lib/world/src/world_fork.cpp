@@ -0,0 +1,159 @@
+#include "world_fork.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "character_store.hpp"
+#include "gridworld.hpp"
+
+WorldFork::WorldFork(const GridWorld& world, const std::vector<size_t>& characterIDs) :
+    world(&world),
+    clock(0.0),
+    tick(world.getTick()) {
+  characters.reserve(characterIDs.size());
+  for (size_t characterID : characterIDs) {
+    constCharacterPtr character = world.getCharacter(characterID);
+    CharacterTraits traits = character->getTraits();
+    characters.push_back(CharacterState{characterID,
+                                        world.getOccupancy().getTile(characterID),
+                                        traits.health,
+                                        traits.health_regen_rate,
+                                        traits.max_health,
+                                        traits.kcal_on_hand,
+                                        traits.kcal_burn_rate,
+                                        character->getReward(),
+                                        true});
+  }
+}
+
+Resources WorldFork::getResources(size_t tileID) const {
+  const TileStore& store = world->getTileStore();
+  double value;
+  double since;
+  size_t pageIndex = tileID / PageSize;
+  auto page = std::find_if(pages.begin(), pages.end(), [pageIndex](const auto& entry) {
+    return entry.first == pageIndex;
+  });
+  if (page != pages.end()) {
+    value = page->second->resources[tileID % PageSize];
+    since = page->second->since[tileID % PageSize];
+  } else {
+    // untouched tiles regrow from their state in the world
+    value = store.getResources(tileID).kcal;
+    since = 0.0;
+  }
+  double regrown = value + store.getResourcesPerHour(tileID).kcal * (clock - since);
+  return Resources{std::min(regrown, store.getMaxResources(tileID).kcal)};
+}
+
+bool WorldFork::isAlive(size_t characterID) const {
+  for (const CharacterState& character : characters) {
+    if (character.id == characterID) {
+      return character.alive;
+    }
+  }
+  return false;
+}
+
+size_t WorldFork::getPosition(size_t characterID) const {
+  return state(characterID).tileID;
+}
+
+CharacterTraits WorldFork::getTraits(size_t characterID) const {
+  const CharacterState& character = state(characterID);
+  return CharacterTraits(character.health, character.healthRegenRate, character.maxHealth,
+                         character.kcalOnHand, character.kcalBurnRate);
+}
+
+double WorldFork::getReward(size_t characterID) const {
+  return state(characterID).reward;
+}
+
+ActionMask WorldFork::getActionMask(size_t characterID) const {
+  return ActionSpace::getMask(world->getTopology(), state(characterID).tileID);
+}
+
+void WorldFork::act(size_t characterID, size_t slot) {
+  queued.emplace_back(characterID, slot);
+}
+
+void WorldFork::update(double elapsedTime) {
+  const GridTopology& topology = world->getTopology();
+  for (const auto& [characterID, slot] : queued) {
+    CharacterState& character = state(characterID);
+    if (!character.alive) {
+      continue;
+    }
+    if (slot == ActionSpace::Harvest) {
+      character.kcalOnHand += getResources(character.tileID).kcal;
+      TilePage& page = writablePage(character.tileID);
+      page.resources[character.tileID % PageSize] = 0.0f;
+      page.since[character.tileID % PageSize] = clock;
+      continue;
+    }
+    // the same rules as MoveAction
+    size_t target = ActionSpace::getTarget(topology, character.tileID, slot);
+    if (target != character.tileID && topology.isAdjacent(character.tileID, target)) {
+      double burn = 2 * character.kcalBurnRate;
+      if (character.kcalOnHand > burn) {
+        character.kcalOnHand -= burn;
+      } else {
+        character.health -= burn - character.kcalOnHand;
+        character.reward -= burn - character.kcalOnHand;
+        character.kcalOnHand = 0;
+      }
+      character.tileID = target;
+    }
+  }
+  queued.clear();
+
+  for (CharacterState& character : characters) {
+    if (!character.alive) {
+      continue;
+    }
+    CharacterStore::metabolize(character.health, character.kcalOnHand, character.reward,
+                               character.healthRegenRate, character.maxHealth, character.kcalBurnRate, elapsedTime);
+    character.alive = character.health > 0;
+  }
+
+  clock += elapsedTime;
+  tick++;
+}
+
+const WorldFork::CharacterState& WorldFork::state(size_t characterID) const {
+  for (const CharacterState& character : characters) {
+    if (character.id == characterID) {
+      return character;
+    }
+  }
+  throw std::out_of_range("Character " + std::to_string(characterID) + " is not simulated by the fork");
+}
+
+WorldFork::CharacterState& WorldFork::state(size_t characterID) {
+  return const_cast<CharacterState&>(static_cast<const WorldFork&>(*this).state(characterID));
+}
+
+WorldFork::TilePage& WorldFork::writablePage(size_t tileID) {
+  size_t pageIndex = tileID / PageSize;
+  auto page = std::find_if(pages.begin(), pages.end(), [pageIndex](const auto& entry) {
+    return entry.first == pageIndex;
+  });
+  if (page == pages.end()) {
+    // first write to the page by any fork, start from the world
+    const TileStore& store = world->getTileStore();
+    auto fresh = std::make_shared<TilePage>();
+    size_t begin = pageIndex * PageSize;
+    size_t end = std::min(begin + PageSize, store.size());
+    for (size_t index = begin; index < end; index++) {
+      fresh->resources[index - begin] = static_cast<float>(getResources(index).kcal);
+      fresh->since[index - begin] = clock;
+    }
+    pages.emplace_back(pageIndex, std::move(fresh));
+    return *pages.back().second;
+  }
+  if (page->second.use_count() > 1) {
+    page->second = std::make_shared<TilePage>(*page->second);
+  }
+  return *page->second;
+}
@@ -0,0 +1,386 @@
+#include "world_snapshot.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gridworld.hpp"
+
+namespace {
+const char Magic[8] = {'S', 'N', 'P', 'C', 'W', 'R', 'L', 'D'};
+// read back differently on a machine of the other byte order
+const uint32_t ByteOrderMark = 0x01020304;
+
+struct CharacterRecord {
+  uint64_t id;
+  uint64_t tileID;
+  double health;
+  double healthRegenRate;
+  double maxHealth;
+  double kcalOnHand;
+  double kcalBurnRate;
+  double reward;
+  // actor state, relative to the start of the actor section
+  uint64_t actorOffset;
+  uint64_t actorSize;
+};
+
+uint64_t align(uint64_t offset) {
+  return (offset + 7) & ~uint64_t(7);
+}
+
+// zero padding up to offset, then bytes
+void writeSection(std::ofstream& out, uint64_t offset, const void* bytes, size_t count) {
+  static const char padding[8] = {};
+  out.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(out.tellp())));
+  out.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(count));
+}
+
+template <class T>
+void assign(std::vector<T>& values, const char* bytes, size_t count) {
+  values.resize(count);
+  if (count > 0) {
+    std::memcpy(values.data(), bytes, count * sizeof(T));
+  }
+}
+
+// an istream over mapped memory, for actors loading their state
+class MemoryBuffer : public std::streambuf {
+public:
+  MemoryBuffer(const char* bytes, size_t count) {
+    char* begin = const_cast<char*>(bytes);
+    setg(begin, begin, begin + count);
+  }
+};
+}
+
+struct WorldSnapshot::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t fileSize;
+
+  uint64_t width;
+  uint64_t height;
+  uint64_t randomSeed;
+  uint32_t neighbourhood;
+  uint32_t toroidal;
+  uint64_t tick;
+  double timeElapsed;
+
+  uint64_t tileCount;
+  uint64_t prototypeCount;
+  uint64_t activeCount;
+  double clock;
+  uint32_t lazy;
+  uint32_t reserved;
+
+  // instance IDs handed out so far, and how many of them are alive
+  uint64_t characterCount;
+  uint64_t livingCount;
+  uint64_t actorBytes;
+
+  // from the start of the file
+  uint64_t prototypesOffset;
+  uint64_t resourcesOffset;
+  uint64_t prototypeOfOffset;
+  uint64_t activeSlotOffset;
+  uint64_t activeOffset;
+  uint64_t activeSinceOffset;
+  uint64_t charactersOffset;
+  uint64_t actorsOffset;
+};
+
+void WorldSnapshot::save(const GridWorld& world, double timeElapsed, const std::string& path) {
+  const TileStore& store = world.tileStore;
+  const CharacterStore& characters = world.characters;
+
+  // actors serialise into one blob, each record knows its slice
+  std::vector<CharacterRecord> records(characters.size());
+  std::ostringstream actorState;
+  for (size_t row = 0; row < characters.size(); row++) {
+    Character& character = *characters[row];
+    CharacterTraits traits = characters.getTraits(row);
+    CharacterRecord& record = records[row];
+    record.id = character.getInstanceID();
+    record.tileID = world.occupancy.getTile(record.id);
+    record.health = traits.health;
+    record.healthRegenRate = traits.health_regen_rate;
+    record.maxHealth = traits.max_health;
+    record.kcalOnHand = traits.kcal_on_hand;
+    record.kcalBurnRate = traits.kcal_burn_rate;
+    record.reward = characters.getReward(row);
+    record.actorOffset = static_cast<uint64_t>(actorState.tellp());
+    if (character.isActionPolicySet() && character.getActor()) {
+      character.getActor()->save(actorState);
+    }
+    record.actorSize = static_cast<uint64_t>(actorState.tellp()) - record.actorOffset;
+  }
+  const std::string actorBytes = actorState.str();
+
+  const GridTopology& topology = world.getTopology();
+  Header header = {};
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.byteOrder = ByteOrderMark;
+  header.width = world.width;
+  header.height = world.height;
+  header.randomSeed = world.randomSeed;
+  header.neighbourhood = static_cast<uint32_t>(topology.getNeighbourhood());
+  header.toroidal = topology.isToroidal();
+  header.tick = world.tick;
+  header.timeElapsed = timeElapsed;
+  header.tileCount = store.size();
+  header.prototypeCount = store.getPrototypeCount();
+  header.activeCount = store.active.size();
+  header.clock = store.clock;
+  header.lazy = store.lazy;
+  header.characterCount = world.characterCount;
+  header.livingCount = records.size();
+  header.actorBytes = actorBytes.size();
+
+  uint64_t offset = align(sizeof(Header));
+  auto place = [&offset](uint64_t& field, uint64_t bytes) {
+    field = offset;
+    offset = align(offset + bytes);
+  };
+  place(header.prototypesOffset, 3 * header.prototypeCount * sizeof(double));
+  place(header.resourcesOffset, header.tileCount * sizeof(float));
+  place(header.prototypeOfOffset, header.tileCount * sizeof(TileStore::PrototypeIndex));
+  place(header.activeSlotOffset, header.tileCount * sizeof(uint32_t));
+  place(header.activeOffset, header.activeCount * sizeof(uint32_t));
+  place(header.activeSinceOffset, header.activeCount * sizeof(double));
+  place(header.charactersOffset, header.livingCount * sizeof(CharacterRecord));
+  place(header.actorsOffset, header.actorBytes);
+  header.fileSize = offset;
+
+  const std::string temporaryPath = path + ".tmp";
+  std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Cannot write snapshot " + temporaryPath);
+  }
+  const uint64_t prototypeBytes = header.prototypeCount * sizeof(double);
+  writeSection(out, 0, &header, sizeof(Header));
+  writeSection(out, header.prototypesOffset, store.prototypeInitial.data(), prototypeBytes);
+  writeSection(out, header.prototypesOffset + prototypeBytes, store.prototypeRate.data(), prototypeBytes);
+  writeSection(out, header.prototypesOffset + 2 * prototypeBytes, store.prototypeCap.data(), prototypeBytes);
+  writeSection(out, header.resourcesOffset, store.resources.data(), header.tileCount * sizeof(float));
+  writeSection(out, header.prototypeOfOffset, store.prototypeOf.data(), header.tileCount * sizeof(TileStore::PrototypeIndex));
+  writeSection(out, header.activeSlotOffset, store.activeSlot.data(), header.tileCount * sizeof(uint32_t));
+  writeSection(out, header.activeOffset, store.active.data(), header.activeCount * sizeof(uint32_t));
+  writeSection(out, header.activeSinceOffset, store.activeSince.data(), header.activeCount * sizeof(double));
+  writeSection(out, header.charactersOffset, records.data(), records.size() * sizeof(CharacterRecord));
+  writeSection(out, header.actorsOffset, actorBytes.data(), actorBytes.size());
+  writeSection(out, header.fileSize, nullptr, 0);
+  out.close();
+  if (!out) {
+    throw std::runtime_error("Cannot write snapshot " + temporaryPath);
+  }
+  if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+    throw std::runtime_error("Cannot replace snapshot " + path);
+  }
+}
+
+WorldSnapshot::WorldSnapshot(const std::string& path) : data(nullptr), size(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open snapshot " + path);
+  }
+  struct stat status;
+  if (fstat(fd, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(Header))) {
+    close(fd);
+    throw std::invalid_argument("Not a world snapshot: " + path);
+  }
+  size = static_cast<size_t>(status.st_size);
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps the file alive
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Cannot map snapshot " + path);
+  }
+  data = static_cast<const char*>(mapping);
+
+  const Header& h = header();
+  if (std::memcmp(h.magic, Magic, sizeof(Magic)) != 0 || h.byteOrder != ByteOrderMark) {
+    munmap(const_cast<char*>(data), size);
+    throw std::invalid_argument("Not a world snapshot: " + path);
+  }
+  if (h.version != Version || h.fileSize != size) {
+    munmap(const_cast<char*>(data), size);
+    throw std::invalid_argument("Unsupported or truncated snapshot: " + path);
+  }
+}
+
+WorldSnapshot::~WorldSnapshot() {
+  munmap(const_cast<char*>(data), size);
+}
+
+const WorldSnapshot::Header& WorldSnapshot::header() const {
+  return *reinterpret_cast<const Header*>(data);
+}
+
+const char* WorldSnapshot::at(uint64_t offset, uint64_t bytes) const {
+  if (offset > size || bytes > size - offset) {
+    throw std::invalid_argument("Corrupt snapshot, section past the end of the file");
+  }
+  return data + offset;
+}
+
+size_t WorldSnapshot::getWidth() const {
+  return header().width;
+}
+
+size_t WorldSnapshot::getHeight() const {
+  return header().height;
+}
+
+size_t WorldSnapshot::getRandomSeed() const {
+  return header().randomSeed;
+}
+
+size_t WorldSnapshot::getTick() const {
+  return header().tick;
+}
+
+double WorldSnapshot::getTimeElapsed() const {
+  return header().timeElapsed;
+}
+
+void WorldSnapshot::restore(GridWorld& world, const ActorFactory& makeActor) const {
+  const Header& h = header();
+  const GridTopology& topology = world.getTopology();
+  if (h.width != world.width || h.height != world.height ||
+      h.neighbourhood != static_cast<uint32_t>(topology.getNeighbourhood()) ||
+      h.toroidal != static_cast<uint32_t>(topology.isToroidal())) {
+    throw std::invalid_argument("Snapshot was taken of a world with a different size or topology");
+  }
+  if (h.tileCount != world.width * world.height) {
+    throw std::invalid_argument("Corrupt snapshot, tile count does not match its size");
+  }
+  const uint64_t prototypeBytes = h.prototypeCount * sizeof(double);
+  const char* prototypes = at(h.prototypesOffset, 3 * prototypeBytes);
+  const char* resources = at(h.resourcesOffset, h.tileCount * sizeof(float));
+  const char* prototypeOf = at(h.prototypeOfOffset, h.tileCount * sizeof(TileStore::PrototypeIndex));
+  const char* activeSlot = at(h.activeSlotOffset, h.tileCount * sizeof(uint32_t));
+  const char* active = at(h.activeOffset, h.activeCount * sizeof(uint32_t));
+  const char* activeSince = at(h.activeSinceOffset, h.activeCount * sizeof(double));
+  const CharacterRecord* records = reinterpret_cast<const CharacterRecord*>(
+      at(h.charactersOffset, h.livingCount * sizeof(CharacterRecord)));
+  const char* actorState = at(h.actorsOffset, h.actorBytes);
+  std::vector<uint64_t> ids(h.livingCount);
+  for (size_t i = 0; i < h.livingCount; i++) {
+    if (records[i].id >= h.characterCount || records[i].tileID >= h.tileCount ||
+        records[i].actorOffset > h.actorBytes || records[i].actorSize > h.actorBytes - records[i].actorOffset) {
+      throw std::invalid_argument("Corrupt snapshot, character record out of range");
+    }
+    ids[i] = records[i].id;
+  }
+  std::sort(ids.begin(), ids.end());
+  if (std::adjacent_find(ids.begin(), ids.end()) != ids.end()) {
+    throw std::invalid_argument("Corrupt snapshot, character saved twice");
+  }
+
+  // the tile arrays are checked before anything of the world is replaced,
+  // regeneration indexes by them without checks
+  std::vector<TileStore::PrototypeIndex> tilePrototypes;
+  std::vector<uint32_t> tileSlots;
+  std::vector<uint32_t> activeTiles;
+  assign(tilePrototypes, prototypeOf, h.tileCount);
+  assign(tileSlots, activeSlot, h.tileCount);
+  assign(activeTiles, active, h.activeCount);
+  if (h.activeCount > h.tileCount) {
+    throw std::invalid_argument("Corrupt snapshot, more active tiles than tiles");
+  }
+  for (size_t i = 0; i < h.tileCount; i++) {
+    if (tilePrototypes[i] >= h.prototypeCount) {
+      throw std::invalid_argument("Corrupt snapshot, tile prototype out of range");
+    }
+    if (tileSlots[i] != TileStore::None && (tileSlots[i] >= h.activeCount || activeTiles[tileSlots[i]] != i)) {
+      throw std::invalid_argument("Corrupt snapshot, active slot of a tile out of range");
+    }
+  }
+  for (size_t slot = 0; slot < h.activeCount; slot++) {
+    if (activeTiles[slot] >= h.tileCount || tileSlots[activeTiles[slot]] != slot) {
+      throw std::invalid_argument("Corrupt snapshot, active tile out of range");
+    }
+  }
+
+  // characters go first, they hold views of the tiles being replaced
+  world.characters.clear();
+  world.characterHandles.assign(h.characterCount, CharacterHandle{UINT32_MAX, 0});
+  world.deadRows.clear();
+  world.occupancy = OccupancyIndex();
+  world.tileViews.clear();
+
+  TileStore& store = world.tileStore;
+  // the regeneration mode is the world's, the saved one only tells how to
+  // read the saved tiles
+  bool lazy = store.isLazy();
+  store.clear();
+  assign(store.prototypeInitial, prototypes, h.prototypeCount);
+  assign(store.prototypeRate, prototypes + prototypeBytes, h.prototypeCount);
+  assign(store.prototypeCap, prototypes + 2 * prototypeBytes, h.prototypeCount);
+  assign(store.resources, resources, h.tileCount);
+  store.prototypeOf = std::move(tilePrototypes);
+  store.activeSlot = std::move(tileSlots);
+  store.active = std::move(activeTiles);
+  assign(store.activeSince, activeSince, h.activeCount);
+  store.clock = h.clock;
+  store.lazy = h.lazy != 0;
+  store.rebuildSchedule();
+  store.setLazy(lazy);
+  world.tileCount = h.tileCount;
+  world.occupancy.resize(world.tileCount);
+  world.spatialIndex.clear();
+  world.spatialIndex.indexTiles();
+
+  // inserted in saved order, so rows, decide order and observations match
+  for (size_t i = 0; i < h.livingCount; i++) {
+    const CharacterRecord& record = records[i];
+    CharacterTraits traits(record.health, record.healthRegenRate, record.maxHealth, record.kcalOnHand, record.kcalBurnRate);
+    CharacterPtr character = std::make_shared<Character>(record.id, traits);
+    character->setPosition(world.getTile(static_cast<size_t>(record.tileID)));
+    CharacterHandle handle = world.characters.insert(std::move(character));
+    world.characters.setReward(world.characters.rowOf(handle), record.reward);
+    world.characterHandles[record.id] = handle;
+    world.occupancy.insert(record.id, record.tileID);
+    world.spatialIndex.insert(record.id, record.tileID);
+  }
+  world.characterCount = h.characterCount;
+  world.tick = h.tick;
+
+  if (world.resourceField) {
+    world.resourceField->build(store);
+  }
+  if (world.observationsEnabled) {
+    world.writeObservations(world.observationFrames[0], nullptr);
+    world.writeObservations(world.observationFrames[1], nullptr);
+    world.previousDirtyTiles.clear();
+  }
+
+  for (size_t i = 0; i < h.livingCount; i++) {
+    const CharacterRecord& record = records[i];
+    ActorPtr actor = makeActor(world, record.id);
+    if (!actor) {
+      continue;
+    }
+    if (record.actorSize > 0) {
+      MemoryBuffer buffer(actorState + record.actorOffset, record.actorSize);
+      std::istream in(&buffer);
+      actor->load(in);
+    }
+    world.getCharacter(record.id)->setActionPolicy(actor);
+  }
+}
@@ -7,8 +7,12 @@
 EXECUTABLE="./bin/GridWorldApp"
 ARGS="config/Data.yaml config/FOMAP.yaml config/SmartActor.yaml config/GridWorld.yaml config/StateValueEstimator.yaml"
 
+# Check if the first argument is "headless"
+if [ "$1" == "headless" ]; then
+    # Run as fast as possible without opening a window
+    ./bin/HeadlessApp $ARGS
 # Check if the first argument is "valgrind"
-if [ "$1" == "valgrind" ]; then
+elif [ "$1" == "valgrind" ]; then
     # Run the application with Valgrind to check for memory corruption and write the output to valgrind_output.txt
     valgrind --tool=memcheck --track-origins=yes --log-file=valgrind_output.txt --read-var-info=yes --show-reachable=yes --undef-value-errors=yes $EXECUTABLE $ARGS
 elif [ "$1" == "gdb" ]; then